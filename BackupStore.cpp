@@ -0,0 +1,172 @@
+// BackupStore.cpp
+#include "BackupStore.h"
+#include "FileCommit.h"
+#include "FileTransaction.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+
+namespace {
+
+const char* const kStoreDir = "SidebarBackups";
+const char* const kCompressedSuffix = ".z";
+
+QByteArray hexHash(const QByteArray& content) {
+    return QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex();
+}
+
+bool readAll(const QString& path, QByteArray& out) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    out = f.readAll();
+    return true;
+}
+
+} // namespace
+
+BackupStore::BackupStore(const QString& levelEditRoot)
+    : m_root(levelEditRoot), m_dir(levelEditRoot + "/" + kStoreDir) {
+}
+
+QString BackupStore::objectPath(const QByteArray& hash) const {
+    return QString("%1/objects/%2/%3").arg(m_dir, QString::fromLatin1(hash.left(2)), QString::fromLatin1(hash));
+}
+
+bool BackupStore::storeObject(const QByteArray& hash, const QByteArray& content, QString* error) const {
+    // Stored once, compressed or not, whichever way it was first written
+    const QString plain = objectPath(hash);
+    if (QFile::exists(plain) || QFile::exists(plain + kCompressedSuffix)) return true;
+
+    QString err;
+    const bool ok = m_compress
+        ? FileCommit::write(plain + kCompressedSuffix, qCompress(content), &err) != FileCommit::Failed
+        : FileCommit::write(plain, content, &err) != FileCommit::Failed;
+    if (!ok && error) *error = err;
+    return ok;
+}
+
+bool BackupStore::loadObject(const QByteArray& hash, QByteArray& content, QString* error) const {
+    const QString plain = objectPath(hash);
+    bool ok = readAll(plain + kCompressedSuffix, content);
+    if (ok) content = qUncompress(content);
+    else ok = readAll(plain, content);
+
+    if (!ok) {
+        if (error) *error = QString("backup content %1 is missing").arg(QString::fromLatin1(hash));
+        return false;
+    }
+    if (hexHash(content) != hash) {
+        if (error) *error = QString("backup content %1 is damaged").arg(QString::fromLatin1(hash));
+        return false;
+    }
+    return true;
+}
+
+bool BackupStore::snapshot(const QStringList& paths, const QString& label, Snapshot* out, QString* error) {
+    const QDir root(m_root);
+    QSet<QString> seen;
+    QJsonArray files;
+    Snapshot snap;
+    for (const QString& path : paths) {
+        const QString absolute = QFileInfo(path).absoluteFilePath();
+        if (seen.contains(absolute) || !QFileInfo(absolute).isFile()) continue;
+        seen.insert(absolute);
+
+        QByteArray content;
+        if (!readAll(absolute, content)) {
+            if (error) *error = QString("cannot read %1 for backup").arg(absolute);
+            return false;
+        }
+        const QByteArray hash = hexHash(content);
+        QString err;
+        if (!storeObject(hash, content, &err)) {
+            if (error) *error = QString("cannot back up %1: %2").arg(absolute, err);
+            return false;
+        }
+
+        QJsonObject o;
+        o["path"] = root.relativeFilePath(absolute);
+        o["hash"] = QString::fromLatin1(hash);
+        o["size"] = double(content.size());
+        files.append(o);
+        snap.bytes += content.size();
+    }
+    if (files.isEmpty()) return true;
+
+    // Ids sort by time; two snapshots in one millisecond get a suffix
+    snap.created = QDateTime::currentDateTimeUtc();
+    const QString stamp = snap.created.toString("yyyyMMdd-HHmmss-zzz");
+    snap.id = stamp;
+    for (int n = 2; QFile::exists(QString("%1/snapshots/%2.json").arg(m_dir, snap.id)); ++n)
+        snap.id = QString("%1-%2").arg(stamp).arg(n);
+    snap.label = label;
+    snap.files = int(files.size());
+
+    QJsonObject manifest;
+    manifest["label"] = label;
+    manifest["created"] = snap.created.toString(Qt::ISODateWithMs);
+    manifest["files"] = files;
+    QString err;
+    if (FileCommit::write(QString("%1/snapshots/%2.json").arg(m_dir, snap.id),
+        QJsonDocument(manifest).toJson(QJsonDocument::Indented), &err) == FileCommit::Failed) {
+        if (error) *error = QString("cannot record backup: %1").arg(err);
+        return false;
+    }
+    if (out) *out = snap;
+    return true;
+}
+
+QVector<BackupStore::Snapshot> BackupStore::snapshots() const {
+    QVector<Snapshot> out;
+    const QDir dir(m_dir + "/snapshots");
+    for (const QString& name : dir.entryList(QStringList("*.json"), QDir::Files, QDir::Name | QDir::Reversed)) {
+        QByteArray raw;
+        if (!readAll(dir.filePath(name), raw)) continue;
+        const QJsonObject manifest = QJsonDocument::fromJson(raw).object();
+        Snapshot s;
+        s.id = QFileInfo(name).completeBaseName();
+        s.label = manifest.value("label").toString();
+        s.created = QDateTime::fromString(manifest.value("created").toString(), Qt::ISODateWithMs);
+        const QJsonArray files = manifest.value("files").toArray();
+        s.files = int(files.size());
+        for (const QJsonValue& v : files) s.bytes += qint64(v.toObject().value("size").toDouble());
+        out.push_back(s);
+    }
+    return out;
+}
+
+bool BackupStore::restore(const QString& id, QStringList* restored, QString* error) {
+    QByteArray raw;
+    if (!readAll(QString("%1/snapshots/%2.json").arg(m_dir, id), raw)) {
+        if (error) *error = QString("no backup %1").arg(id);
+        return false;
+    }
+    const QJsonObject manifest = QJsonDocument::fromJson(raw).object();
+
+    // Every content is loaded and checked before anything is written
+    const QDir root(m_root);
+    QStringList targets;
+    QVector<QByteArray> contents;
+    for (const QJsonValue& v : manifest.value("files").toArray()) {
+        const QJsonObject o = v.toObject();
+        QByteArray content;
+        if (!loadObject(o.value("hash").toString().toLatin1(), content, error)) return false;
+        targets << root.absoluteFilePath(o.value("path").toString());
+        contents.push_back(content);
+    }
+
+    if (!snapshot(targets, QString("Before restoring %1").arg(id), nullptr, error)) return false;
+
+    FileTransaction tx(journalPath());
+    QStringList changed;
+    for (int i = 0; i < targets.size(); ++i)
+        if (tx.stage(targets.at(i), contents.at(i))) changed << root.relativeFilePath(targets.at(i));
+    if (!tx.commit(error)) return false;
+    if (restored) *restored = changed;
+    return true;
+}
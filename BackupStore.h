@@ -0,0 +1,60 @@
+// BackupStore.h
+#pragma once
+
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Content-addressed copies of the files a bulk write is about to replace,
+// kept under "<LevelEdit>/SidebarBackups":
+//
+//   objects/ab/ab12...ef     one file content, named by its SHA-1
+//   objects/ab/ab12...ef.z   the same, qCompress'd
+//   snapshots/<id>.json      { "label", "created", "files": [ { "path", "hash", "size" } ] }
+//
+// A snapshot stores each content once, however many runs saw it, so a run
+// costs the bytes of the files that changed since the last one. Paths in a
+// snapshot are relative to the LevelEdit folder. Restoring puts a
+// snapshot's files back in one FileTransaction, after snapshotting what it
+// replaces; files created after the snapshot are left alone.
+class BackupStore {
+public:
+    struct Snapshot {
+        QString id;          // also the manifest's file name; sorts by time
+        QString label;       // the operation that took it
+        QDateTime created;
+        int files = 0;
+        qint64 bytes = 0;    // total size of the files as they were
+    };
+
+    explicit BackupStore(const QString& levelEditRoot);
+
+    // New contents are stored compressed (the default) or as they are.
+    void setCompression(bool on) { m_compress = on; }
+    QString location() const { return m_dir; }
+    // FileTransaction journal of restore(); settle it at startup.
+    QString journalPath() const { return m_dir + "/restore_journal.json"; }
+
+    // Stores the current content of every existing path and records them as
+    // one snapshot. Missing paths are skipped; with none left nothing is
+    // recorded and *out stays empty. False, with *error, if any file could
+    // not be read or stored: the write it guards should not go ahead.
+    bool snapshot(const QStringList& paths, const QString& label, Snapshot* out = nullptr, QString* error = nullptr);
+
+    // Newest first.
+    QVector<Snapshot> snapshots() const;
+
+    // Writes the snapshot's files back, all or none; the current versions
+    // are snapshotted first, so a restore can be undone the same way.
+    bool restore(const QString& id, QStringList* restored = nullptr, QString* error = nullptr);
+
+private:
+    QString objectPath(const QByteArray& hash) const;
+    bool storeObject(const QByteArray& hash, const QByteArray& content, QString* error) const;
+    bool loadObject(const QByteArray& hash, QByteArray& content, QString* error) const;
+
+    QString m_root;
+    QString m_dir;
+    bool m_compress = true;
+};
@@ -0,0 +1,437 @@
+// BatchCli.cpp
+#include "BatchCli.h"
+#include "BackupStore.h"
+#include "FileTransaction.h"
+#include "JsonStreamWriter.h"
+#include "LineDiff.h"
+#include "SidebarEngine.h"
+#include "TaskScheduler.h"
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSettings>
+#include <QTextStream>
+#include <QtConcurrent/QtConcurrentMap>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+const QStringList kCommands = {
+    "update-master",      // Update Global from Current Tabs (selected lists)
+    "propagate-master",   // Propagate changes to All
+    "update-levels",      // Update Levels from Current Tabs
+    "propagate-levels",   // Propagate changes to Levels
+    "apply-camo",         // Apply camo to level files
+    "export-all",         // Export All to GlobalSettings.json
+    "list-backups",       // Snapshots taken before bulk writes
+    "restore-backup",     // Restore Backup (--snapshot)
+};
+
+QJsonArray toJson(const QStringList& xs) {
+    QJsonArray out;
+    for (const QString& x : xs) out.append(x);
+    return out;
+}
+
+void printReport(const QJsonObject& report) {
+    QFile out;
+    if (!out.open(stdout, QIODevice::WriteOnly)) return;
+    JsonStreamWriter w(&out);
+    w.value(nullptr, QJsonValue(report));
+}
+
+// Comma-separated values, blanks dropped.
+QStringList splitList(const QString& s) {
+    QStringList out;
+    for (const QString& part : s.split(',')) {
+        const QString t = part.trimmed();
+        if (!t.isEmpty()) out << t;
+    }
+    return out;
+}
+
+// "saved" (the editor's last choice), "all", or list names / ids.
+bool resolveLists(const SidebarEngine& engine, const QString& spec, QSet<QString>& out, QString* error) {
+    if (spec == "saved") {
+        const QStringList saved = QSettings("SidebarTool", "SidebarEditor").value("SelectedLists").toStringList();
+        out = QSet<QString>(saved.cbegin(), saved.cend());
+        return true;
+    }
+    for (const QString& want : splitList(spec)) {
+        bool found = false;
+        for (const PurchaseList& pl : engine.lists()) {
+            if (want == "all" || pl.id == want || pl.name.compare(want, Qt::CaseInsensitive) == 0) {
+                out.insert(pl.id);
+                found = true;
+            }
+        }
+        if (!found) {
+            *error = QString("unknown list '%1'").arg(want);
+            return false;
+        }
+    }
+    return true;
+}
+
+// "all" or level names; unknown levels are an error.
+bool resolveLevels(const SidebarEngine& engine, const QString& spec, QStringList& out, QString* error) {
+    const QStringList existing = engine.levels();
+    if (spec == "all") {
+        out = existing;
+        return true;
+    }
+    for (const QString& level : splitList(spec)) {
+        if (!existing.contains(level)) {
+            *error = QString("unknown level '%1'").arg(level);
+            return false;
+        }
+        out << level;
+    }
+    return true;
+}
+
+// Level -> camo, as saved by "Assign Camouflage to Levels".
+QMap<QString, QString> loadCamoProfile(const QString& path) {
+    QMap<QString, QString> out;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return out;
+    const QJsonObject saved = QJsonDocument::fromJson(f.readAll()).object();
+    for (auto it = saved.constBegin(); it != saved.constEnd(); ++it) {
+        const QString theme = it.value().toString();
+        if (!theme.isEmpty()) out.insert(it.key(), theme);
+    }
+    return out;
+}
+
+// A dry run's changes with their unified diffs, worked out on the thread
+// pool. Diff headers name files relative to root.
+QJsonArray diffsJson(const QVector<SidebarEngine::FileChange>& changes, const QString& root) {
+    QVector<QByteArray> diffs(changes.size());
+    QByteArray* const diff = diffs.data();
+    QVector<int> order(changes.size());
+    std::iota(order.begin(), order.end(), 0);
+    const QDir dir(root);
+    QtConcurrent::blockingMap(order, [&](int& i) {
+        const SidebarEngine::FileChange& c = changes.at(i);
+        diff[i] = LineDiff::unified(c.before, c.after, dir.relativeFilePath(c.path));
+        });
+
+    QJsonArray out;
+    for (int i = 0; i < changes.size(); ++i) {
+        QJsonObject o;
+        o["path"] = changes.at(i).path;
+        o["diff"] = QString::fromUtf8(diffs.at(i));
+        out.append(o);
+    }
+    return out;
+}
+
+} // namespace
+
+bool BatchCli::requested(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i)
+        if (std::strcmp(argv[i], "--batch") == 0) return true;
+    return false;
+}
+
+int BatchCli::run(const QStringList& arguments) {
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Sidebar Editor batch mode. Prints a JSON report on stdout.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", kCommands.join(" | "));
+    const QCommandLineOption batchOpt("batch", "Run without a window.");
+    const QCommandLineOption rootOpt("root", "LevelEdit folder (default: the editor's saved one).", "dir");
+    const QCommandLineOption listsOpt("lists",
+        "Source lists: comma-separated names or ids, 'all', or 'saved' (default, the editor's last selection).",
+        "lists", "saved");
+    const QCommandLineOption editsOpt("edits",
+        "GlobalSettings-shaped JSON whose items replace the matching units (base + alt preset IDs).", "file");
+    const QCommandLineOption levelsOpt("levels",
+        "Target levels: comma-separated RA_* names or 'all' (default; camo commands: every level with a camo).",
+        "levels");
+    const QCommandLineOption camoOpt("camo-profile", "Level to camo assignments.", "file", "camo_profile.json");
+    const QCommandLineOption jobsOpt("jobs", "Worker threads (default: one per core).", "n");
+    const QCommandLineOption dryRunOpt("dry-run",
+        "update-levels, apply-camo: write nothing; report per-level summaries and unified diffs.");
+    const QCommandLineOption snapshotOpt("snapshot", "restore-backup: snapshot id, or 'latest'.", "id");
+    const QCommandLineOption rawBackupsOpt("no-backup-compression", "Store new backup contents uncompressed.");
+    parser.addOptions({ batchOpt, rootOpt, listsOpt, editsOpt, levelsOpt, camoOpt, jobsOpt, dryRunOpt,
+        snapshotOpt, rawBackupsOpt });
+
+    if (!parser.parse(arguments)) {
+        err << parser.errorText() << "\n";
+        return 2;
+    }
+    if (parser.isSet("help")) {
+        QTextStream(stdout) << parser.helpText();
+        return 0;
+    }
+    const QStringList positional = parser.positionalArguments();
+    if (positional.size() != 1 || !kCommands.contains(positional.first())) {
+        err << "expected one command: " << kCommands.join(", ") << "\n";
+        return 2;
+    }
+    const QString command = positional.first();
+    const bool dryRun = parser.isSet(dryRunOpt);
+    if (dryRun && command != "update-levels" && command != "apply-camo") {
+        err << "--dry-run only applies to update-levels and apply-camo\n";
+        return 2;
+    }
+
+    if (parser.isSet(jobsOpt)) {
+        bool ok = false;
+        const int jobs = parser.value(jobsOpt).toInt(&ok);
+        if (!ok || jobs < 1) {
+            err << "--jobs needs a positive number\n";
+            return 2;
+        }
+        TaskScheduler::instance().setWorkerCount(jobs);
+    }
+
+    const QString root = parser.isSet(rootOpt)
+        ? parser.value(rootOpt)
+        : QSettings("SidebarTool", "SidebarEditor").value("LevelEditRoot").toString();
+    if (root.isEmpty() || !QDir(root).exists()) {
+        err << "no LevelEdit folder; pass --root\n";
+        return 2;
+    }
+
+    QJsonObject report;
+    report["command"] = command;
+    report["root"] = root;
+    if (dryRun) report["dryRun"] = true;
+
+    // Same as at editor startup: settle a level update a crash left behind
+    QString interrupted;
+    const QString journal = SidebarEngine::levelUpdateJournal(root);
+    switch (FileTransaction::recover(journal, &interrupted)) {
+    case FileTransaction::Clean: break;
+    case FileTransaction::Finished: report["recovered"] = "finished"; break;
+    case FileTransaction::RolledBack: report["recovered"] = "rolled back"; break;
+    case FileTransaction::Busy: report["recovered"] = "skipped, in use by " + interrupted; break;
+    case FileTransaction::Failed:
+        report["ok"] = false;
+        report["error"] = QString("cannot recover %1").arg(journal);
+        printReport(report);
+        return 1;
+    }
+
+    // Backups need no master: it may be the file being restored
+    BackupStore backups(root);
+    switch (FileTransaction::recover(backups.journalPath(), &interrupted)) {
+    case FileTransaction::Clean: break;
+    case FileTransaction::Finished: report["recoveredRestore"] = "finished"; break;
+    case FileTransaction::RolledBack: report["recoveredRestore"] = "rolled back"; break;
+    case FileTransaction::Busy: report["recoveredRestore"] = "skipped, in use by " + interrupted; break;
+    case FileTransaction::Failed:
+        report["ok"] = false;
+        report["error"] = QString("cannot recover %1").arg(backups.journalPath());
+        printReport(report);
+        return 1;
+    }
+    if (command == "list-backups") {
+        QJsonArray list;
+        for (const BackupStore::Snapshot& s : backups.snapshots()) {
+            QJsonObject o;
+            o["id"] = s.id;
+            o["label"] = s.label;
+            o["created"] = s.created.toString(Qt::ISODate);
+            o["files"] = s.files;
+            o["bytes"] = double(s.bytes);
+            list.append(o);
+        }
+        report["snapshots"] = list;
+        report["ok"] = true;
+        printReport(report);
+        return 0;
+    }
+    if (command == "restore-backup") {
+        QString id = parser.value(snapshotOpt);
+        if (id == "latest") {
+            const QVector<BackupStore::Snapshot> all = backups.snapshots();
+            id = all.isEmpty() ? QString() : all.first().id;
+        }
+        if (id.isEmpty()) {
+            err << "restore-backup needs --snapshot <id> or a backup to restore\n";
+            return 2;
+        }
+        QStringList restored;
+        QString error;
+        const bool ok = backups.restore(id, &restored, &error);
+        report["snapshot"] = id;
+        report["restored"] = toJson(restored);
+        if (!ok) report["error"] = error;
+        report["ok"] = ok;
+        printReport(report);
+        return ok ? 0 : 1;
+    }
+
+    SidebarEngine engine(root);
+    engine.setBackupCompression(!parser.isSet(rawBackupsOpt));
+    QString error;
+    if (!engine.loadMaster(engine.masterPath(), &error)) {
+        report["ok"] = false;
+        report["error"] = error;
+        printReport(report);
+        return 1;
+    }
+
+    QSet<QString> selected;
+    if (!resolveLists(engine, parser.value(listsOpt), selected, &error)) {
+        err << error << "\n";
+        return 2;
+    }
+    TabLists tabs = engine.tabsForSelection(selected);
+    report["lists"] = toJson(QStringList(selected.cbegin(), selected.cend()));
+
+    if (parser.isSet(editsOpt)) {
+        QVector<PurchaseItem> edits;
+        if (!SidebarEngine::readItems(parser.value(editsOpt), edits, &error)) {
+            err << error << "\n";
+            return 2;
+        }
+        report["editsApplied"] = SidebarEngine::applyEdits(tabs, edits);
+    }
+
+    const QMap<QString, QString> camo = loadCamoProfile(parser.value(camoOpt));
+    const bool camoCommand = command == "apply-camo" || command == "export-all";
+    QStringList levels;
+    if (!resolveLevels(engine, parser.isSet(levelsOpt) ? parser.value(levelsOpt) : QString("all"), levels, &error)) {
+        err << error << "\n";
+        return 2;
+    }
+
+    bool ok = true;
+    if (command == "update-master" || command == "propagate-master") {
+        const SidebarEngine::MasterReport r = engine.updateMaster(tabs, selected, command == "update-master");
+        report["patched"] = r.patched;
+        report["merged"] = r.merged;
+        report["conflicts"] = toJson(r.conflicts);
+        if (!r.error.isEmpty()) report["error"] = r.error;
+        ok = r.error.isEmpty();
+    }
+    else if (command == "update-levels") {
+        QVector<SidebarEngine::LevelPlan> plan;
+        const SidebarEngine::LevelReport r = engine.updateLevels(tabs, selected, levels, camo, dryRun ? &plan : nullptr);
+        report["updated"] = toJson(r.updated);
+        report["failed"] = toJson(r.failed);
+        QJsonArray created;
+        for (const auto& c : r.created) {
+            QJsonObject o;
+            o["level"] = c.level;
+            o["team"] = c.team;
+            o["type"] = c.type;
+            o["defId"] = c.defId;
+            o["name"] = c.name;
+            created.append(o);
+        }
+        report["created"] = created;
+        if (dryRun) {
+            // Diff every level's files in one parallel pass
+            QVector<SidebarEngine::FileChange> changes;
+            for (const SidebarEngine::LevelPlan& p : plan) changes += p.changes;
+            const QJsonArray files = diffsJson(changes, root);
+
+            QJsonArray levelPlans;
+            int next = 0;
+            for (const SidebarEngine::LevelPlan& p : plan) {
+                QJsonObject o;
+                o["level"] = p.level;
+                o["failed"] = p.failed;
+                o["patched"] = p.patched;
+                o["appended"] = p.appended;
+                o["newSections"] = p.created.size();
+                QJsonArray levelFiles;
+                for (int i = 0; i < p.changes.size(); ++i) levelFiles.append(files.at(next++));
+                o["files"] = levelFiles;
+                levelPlans.append(o);
+            }
+            report["plan"] = levelPlans;
+            ok = r.failed.isEmpty();
+        }
+        else {
+            report["committed"] = r.committed;
+            if (!r.error.isEmpty()) report["error"] = r.error;
+            ok = r.committed;
+        }
+    }
+    else if (command == "propagate-levels") {
+        const SidebarEngine::PropagateReport r = engine.propagateToLevels(tabs);
+        report["candidates"] = r.candidates;
+        report["levels"] = r.levels;
+        report["patched"] = r.patched;
+        report["failed"] = toJson(r.failed);
+        if (!r.error.isEmpty()) report["error"] = r.error;
+        ok = r.failed.isEmpty();
+    }
+    else if (camoCommand) {
+        // Only levels with a camo assigned take part
+        QMap<QString, QString> assigned;
+        QStringList skipped;
+        for (const QString& level : levels) {
+            if (camo.contains(level)) assigned.insert(level, camo.value(level));
+            else if (parser.isSet(levelsOpt)) skipped << level;
+        }
+        report["skipped"] = toJson(skipped);
+
+        if (command == "export-all") {
+            const SidebarEngine::ExportReport r = engine.exportAllMapJsons(tabs, assigned);
+            report["exported"] = toJson(r.exported);
+            report["failed"] = toJson(r.failed);
+            if (!r.error.isEmpty()) report["error"] = r.error;
+            ok = r.failed.isEmpty();
+        }
+        else {
+            struct CamoJob {
+                QString level;
+                QString theme;
+                SidebarEngine::FileChange change;   // dry run only
+                SidebarEngine::CamoResult result = SidebarEngine::CamoUnchanged;
+            };
+            QVector<CamoJob> jobs;
+            QStringList paths;
+            for (auto it = assigned.cbegin(); it != assigned.cend(); ++it) {
+                jobs.push_back(CamoJob{ it.key(), it.value() });
+                paths << engine.levelFilePath(it.key());
+            }
+            if (!dryRun && !engine.backUp(paths, "Apply camo", &error)) {
+                report["error"] = error;
+                report["ok"] = false;
+                printReport(report);
+                return 1;
+            }
+            QtConcurrent::blockingMap(jobs, [&engine, dryRun](CamoJob& job) {
+                job.result = engine.reorderCamoInLevelFile(job.level, job.theme, dryRun ? &job.change : nullptr);
+                });
+
+            QStringList changed, unchanged, failed;
+            QVector<SidebarEngine::FileChange> changes;
+            for (const CamoJob& job : jobs) {
+                switch (job.result) {
+                case SidebarEngine::CamoChanged:
+                    changed << job.level;
+                    if (dryRun) changes.push_back(job.change);
+                    break;
+                case SidebarEngine::CamoFailed: failed << job.level; break;
+                case SidebarEngine::CamoUnchanged: unchanged << job.level; break;
+                }
+            }
+            report["changed"] = toJson(changed);
+            report["unchanged"] = toJson(unchanged);
+            report["failed"] = toJson(failed);
+            ok = failed.isEmpty();
+            if (dryRun) report["files"] = diffsJson(changes, root);
+        }
+    }
+
+    report["ok"] = ok;
+    printReport(report);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+// BatchCli.h
+#pragma once
+
+#include <QStringList>
+
+// Headless mode: `SidebarEditor --batch <command> [options]`.
+//
+// Runs the SidebarEngine operations behind the menu actions under a
+// QCoreApplication, so nothing needs a display: no dialogs, no message
+// boxes. The outcome is printed on stdout as one JSON object and the exit
+// code says whether the run succeeded (0), failed (1) or was misused (2).
+class BatchCli {
+public:
+    // True if argv asks for batch mode; checked before any QApplication exists.
+    static bool requested(int argc, char* argv[]);
+
+    static int run(const QStringList& arguments);
+};
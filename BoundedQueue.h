@@ -0,0 +1,53 @@
+// BoundedQueue.h
+#pragma once
+
+#include <QMutex>
+#include <QQueue>
+#include <QWaitCondition>
+#include <utility>
+
+// Blocking FIFO between two pipeline stages, holding at most `capacity`
+// items. push() waits while the queue is full, which is what slows a fast
+// stage down to the pace of the next one; pop() waits while it is empty.
+// After close(), pop() drains what is left and then returns false.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(int capacity) : m_capacity(capacity > 0 ? capacity : 1) {}
+
+    // False if the queue was closed; the item is dropped.
+    bool push(T item) {
+        QMutexLocker lock(&m_mutex);
+        while (!m_closed && m_items.size() >= m_capacity) m_notFull.wait(&m_mutex);
+        if (m_closed) return false;
+        m_items.enqueue(std::move(item));
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    // False once the queue is closed and empty.
+    bool pop(T& out) {
+        QMutexLocker lock(&m_mutex);
+        while (!m_closed && m_items.isEmpty()) m_notEmpty.wait(&m_mutex);
+        if (m_items.isEmpty()) return false;
+        out = m_items.dequeue();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    // No more items will come; wakes every waiting consumer.
+    void close() {
+        QMutexLocker lock(&m_mutex);
+        m_closed = true;
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<T> m_items;
+    int m_capacity;
+    bool m_closed = false;
+};
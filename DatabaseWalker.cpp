@@ -0,0 +1,86 @@
+// DatabaseWalker.cpp
+#include "DatabaseWalker.h"
+#include "BoundedQueue.h"
+#include "TaskScheduler.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFuture>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Threads looking up level files; stats are latency, not CPU
+constexpr int kLevelLookups = 4;
+// Paths found but not yet scanned
+constexpr int kPathQueue = 256;
+
+} // namespace
+
+DatabaseWalker::DatabaseWalker(const QString& levelEditRoot)
+    : m_database(levelEditRoot + "/Database") {
+}
+
+QStringList DatabaseWalker::levels(const QString& nameFilter) const {
+    const QDir dir(m_database + "/Levels");
+    const QStringList filters = nameFilter.isEmpty() ? QStringList() : QStringList(nameFilter);
+    return dir.entryList(filters, QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+}
+
+void DatabaseWalker::forEachFile(int areas, const std::function<void(const QString&)>& scan, int workers) const {
+    if (workers <= 0) workers = std::max(1, TaskScheduler::instance().workerCount());
+
+    QStringList globalTrees;
+    if (areas & GlobalDefinitions) globalTrees << m_database + "/Global/Definitions";
+    if (areas & GlobalPresets) globalTrees << m_database + "/Global/Presets";
+    QStringList levelFiles;   // relative to a level folder
+    if (areas & LevelDefinitions) levelFiles << "/Definitions/GlobalSettings.json";
+    if (areas & LevelPresets) levelFiles << "/Presets/GlobalSettings.json";
+    const QStringList levelNames = levelFiles.isEmpty() ? QStringList() : levels();
+
+    // Enumerators wait on the share, so they get threads of their own.
+    // Scanning is CPU work and runs on the scheduler's workers, the calling
+    // thread being one of them: the run never takes more than `workers`
+    // scanning threads, and always makes progress even if it is itself
+    // running on a busy scheduler thread.
+    const int lookups = levelNames.isEmpty() ? 0 : std::min(kLevelLookups, int(levelNames.size()));
+    QThreadPool enumeratorPool;
+    enumeratorPool.setMaxThreadCount(std::max(1, int(globalTrees.size()) + lookups));
+    BoundedQueue<QString> found(kPathQueue);
+    // The last enumerator to finish closes the queue
+    std::atomic<int> enumerating{ int(globalTrees.size()) + lookups };
+    if (!enumerating) found.close();
+
+    QVector<QFuture<void>> enumerators, scanners;
+    for (const QString& tree : globalTrees) {
+        enumerators << QtConcurrent::run(&enumeratorPool, [&found, &enumerating, tree] {
+            QDirIterator it(tree, QStringList{ "*.json" }, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) found.push(it.next());
+            if (--enumerating == 0) found.close();
+            });
+    }
+    std::atomic<int> nextLevel{ 0 };
+    for (int t = 0; t < lookups; ++t) {
+        enumerators << QtConcurrent::run(&enumeratorPool, [&] {
+            for (int i = nextLevel++; i < levelNames.size(); i = nextLevel++) {
+                const QString dir = m_database + "/Levels/" + levelNames.at(i);
+                for (const QString& file : levelFiles)
+                    if (QFileInfo(dir + file).isFile()) found.push(dir + file);
+            }
+            if (--enumerating == 0) found.close();
+            });
+    }
+    auto drain = [&found, &scan] {
+        QString path;
+        while (found.pop(path)) scan(path);
+        };
+    for (int w = 1; w < workers; ++w) scanners << QtConcurrent::run(TaskScheduler::instance().pool(), drain);
+    drain();
+
+    for (QFuture<void>& f : scanners) f.waitForFinished();
+    for (QFuture<void>& f : enumerators) f.waitForFinished();
+}
@@ -0,0 +1,46 @@
+// DatabaseWalker.h
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+// Finds the JSON files of a LevelEdit Database by its layout rather than
+// by walking all of it:
+//
+//   Database/Global/Definitions/**.json
+//   Database/Global/Presets/**.json
+//   Database/Levels/<level>/Definitions/GlobalSettings.json
+//   Database/Levels/<level>/Presets/GlobalSettings.json
+//
+// The global trees are listed recursively, but a level folder is never
+// listed at all: its two files are looked up by name. Enumeration runs on
+// a few threads (the level lookups are spread over them, which is what
+// pays on a network share) and each file found goes straight to the scan
+// workers on the scheduler's pool, so scanning starts with the first file,
+// not after the walk.
+class DatabaseWalker {
+public:
+    enum Area {
+        GlobalDefinitions = 0x1,
+        GlobalPresets = 0x2,
+        LevelDefinitions = 0x4,
+        LevelPresets = 0x8,
+        AllAreas = 0xF,
+    };
+
+    explicit DatabaseWalker(const QString& levelEditRoot);
+
+    // Every folder under Database/Levels, sorted; with a filter such as
+    // "RA_*" only those that match.
+    QStringList levels(const QString& nameFilter = QString()) const;
+
+    // Calls scan(path) for every existing file of the given areas, on up to
+    // `workers` threads at once, the calling one included (0: the
+    // scheduler's worker count). Blocks until all are done; scan must be
+    // thread-safe.
+    void forEachFile(int areas, const std::function<void(const QString& path)>& scan, int workers = 0) const;
+
+private:
+    QString m_database;
+};
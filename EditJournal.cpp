@@ -0,0 +1,280 @@
+// EditJournal.cpp
+#include "EditJournal.h"
+#include "FileCommit.h"
+#include <QHash>
+#include <QPair>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char kMagic[4] = { 'S', 'B', 'E', 'J' };
+const char kVersion = 1;
+// Below this the file is never compacted
+const qint64 kCompactBytes = 64 * 1024;
+
+const EditJournal::Field kFields[] = {
+    EditJournal::Cost, EditJournal::TechLevel, EditJournal::SpecialTechNumber, EditJournal::UnitLimit,
+    EditJournal::Factory, EditJournal::TechBuilding, EditJournal::FactoryNotRequired,
+};
+
+const char* fieldName(EditJournal::Field f) {
+    switch (f) {
+    case EditJournal::Cost: return "COST";
+    case EditJournal::TechLevel: return "TECH_LEVEL";
+    case EditJournal::SpecialTechNumber: return "SPECIAL_TECH_NUMBER";
+    case EditJournal::UnitLimit: return "UNIT_LIMIT";
+    case EditJournal::Factory: return "FACTORY";
+    case EditJournal::TechBuilding: return "TECH_BUILDING";
+    case EditJournal::FactoryNotRequired: return "FACTORY_NOT_REQUIRED";
+    }
+    return "?";
+}
+
+qint32 fieldValue(const PurchaseItem& it, EditJournal::Field f) {
+    switch (f) {
+    case EditJournal::Cost: return it.cost;
+    case EditJournal::TechLevel: return it.techLevel;
+    case EditJournal::SpecialTechNumber: return it.specialTechNumber;
+    case EditJournal::UnitLimit: return it.unitLimit;
+    case EditJournal::Factory: return it.factory;
+    case EditJournal::TechBuilding: return it.techBuilding;
+    case EditJournal::FactoryNotRequired: return it.factoryNotRequired ? 1 : 0;
+    }
+    return 0;
+}
+
+void setFieldValue(PurchaseItem& it, EditJournal::Field f, qint32 v) {
+    switch (f) {
+    case EditJournal::Cost: it.cost = v; break;
+    case EditJournal::TechLevel: it.techLevel = v; break;
+    case EditJournal::SpecialTechNumber: it.specialTechNumber = v; break;
+    case EditJournal::UnitLimit: it.unitLimit = v; break;
+    case EditJournal::Factory: it.factory = v; break;
+    case EditJournal::TechBuilding: it.techBuilding = v; break;
+    case EditJournal::FactoryNotRequired: it.factoryNotRequired = v != 0; break;
+    }
+}
+
+quint32 fnv1a(const char* data, int size) {
+    quint32 h = 2166136261u;
+    for (int i = 0; i < size; ++i) {
+        h ^= quint8(data[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+template <typename T>
+void put(QByteArray& out, T v) {
+    v = qToLittleEndian(v);
+    out.append(reinterpret_cast<const char*>(&v), int(sizeof v));
+}
+
+template <typename T>
+bool get(const QByteArray& in, int& at, T& v) {
+    if (at + int(sizeof v) > in.size()) return false;
+    std::memcpy(&v, in.constData() + at, sizeof v);
+    v = qFromLittleEndian(v);
+    at += int(sizeof v);
+    return true;
+}
+
+QByteArray encodeHeader(const QString& master) {
+    const QByteArray path = master.toUtf8();
+    QByteArray out(kMagic, int(sizeof kMagic));
+    out.append(kVersion);
+    put<quint16>(out, quint16(path.size()));
+    out.append(path);
+    return out;
+}
+
+QByteArray encodeEdit(const EditJournal::Edit& e) {
+    const QByteArray key = e.key.toLatin1();
+    QByteArray payload;
+    payload.reserve(11 + key.size());
+    payload.append(char(e.field));
+    put<qint32>(payload, e.before);
+    put<qint32>(payload, e.after);
+    put<quint16>(payload, quint16(key.size()));
+    payload.append(key);
+
+    QByteArray out;
+    out.reserve(payload.size() + 6);
+    put<quint16>(out, quint16(payload.size()));
+    out.append(payload);
+    put<quint32>(out, fnv1a(payload.constData(), int(payload.size())));
+    return out;
+}
+
+// Reads a journal as far as it is intact. Returns the length of that
+// part, or -1 without a valid header.
+int decode(const QByteArray& raw, QString* master, QVector<EditJournal::Edit>* edits) {
+    int at = int(sizeof kMagic) + 1;
+    quint16 pathLen = 0;
+    if (!raw.startsWith(QByteArray(kMagic, int(sizeof kMagic))) || raw.size() < at || raw.at(at - 1) != kVersion
+        || !get(raw, at, pathLen) || at + pathLen > raw.size())
+        return -1;
+    *master = QString::fromUtf8(raw.constData() + at, pathLen);
+    at += pathLen;
+
+    for (;;) {
+        int next = at;
+        quint16 size = 0;
+        quint32 sum = 0;
+        if (!get(raw, next, size) || next + size > raw.size()) break;
+        const char* payload = raw.constData() + next;
+        next += size;
+        if (!get(raw, next, sum) || sum != fnv1a(payload, size)) break;
+
+        const QByteArray p = QByteArray::fromRawData(payload, size);
+        int q = 1;
+        EditJournal::Edit e;
+        quint16 keyLen = 0;
+        if (size < 1 || !get(p, q, e.before) || !get(p, q, e.after) || !get(p, q, keyLen) || q + keyLen != size) break;
+        const quint8 field = quint8(payload[0]);
+        if (field < EditJournal::Cost || field > EditJournal::FactoryNotRequired) break;
+        e.field = EditJournal::Field(field);
+        e.key = QString::fromLatin1(payload + q, keyLen);
+        edits->push_back(e);
+        at = next;
+    }
+    return at;
+}
+
+} // namespace
+
+bool EditJournal::open(const QString& path, const QString& masterPath, QString* error) {
+    m_file.close();
+    m_file.setFileName(path);
+    m_master = masterPath;
+    m_edits.clear();
+
+    int intact = -1;
+    if (m_file.open(QIODevice::ReadOnly)) {
+        const QByteArray raw = m_file.readAll();
+        m_file.close();
+        QString master;
+        QVector<Edit> edits;
+        intact = decode(raw, &master, &edits);
+        if (intact >= 0 && master == masterPath) {
+            m_edits = edits;
+        }
+        else if (!raw.isEmpty()) {
+            // Another master's edits, or not a journal: keep it, start over
+            QFile::remove(path + ".other");
+            QFile::rename(path, path + ".other");
+            intact = -1;
+        }
+    }
+
+    bool ok;
+    if (intact < 0) {
+        ok = rewrite();
+    }
+    else {
+        // A torn last record is cut off so appends follow the intact ones
+        ok = m_file.open(QIODevice::ReadWrite) && m_file.resize(intact) && m_file.seek(intact);
+    }
+    if (!ok) {
+        m_file.close();
+        if (error) *error = QString("cannot write %1").arg(path);
+        return false;
+    }
+    m_compactAt = std::max(kCompactBytes, 2 * m_file.size());
+    return true;
+}
+
+int EditJournal::record(const PurchaseItem& before, const PurchaseItem& after) {
+    if (!isOpen()) return 0;
+
+    const QString key = SidebarEngine::unitKey(before);
+    QByteArray out;
+    int recorded = 0;
+    for (Field f : kFields) {
+        const qint32 was = fieldValue(before, f);
+        const qint32 now = fieldValue(after, f);
+        if (was == now) continue;
+        const Edit e{ key, f, was, now };
+        out += encodeEdit(e);
+        m_edits.push_back(e);
+        ++recorded;
+    }
+    if (!recorded) return 0;
+
+    // To the OS in one write: a crash of the editor cannot lose it
+    m_file.write(out);
+    m_file.flush();
+    if (m_file.size() > m_compactAt) compact();
+    return recorded;
+}
+
+EditJournal::ReplayReport EditJournal::replay(TabLists& tabs) const {
+    ReplayReport report;
+    QHash<QString, QVector<QPair<QString, PurchaseItem*>>> byKey;
+    for (auto it = tabs.begin(); it != tabs.end(); ++it)
+        for (PurchaseItem& item : it.value())
+            byKey[SidebarEngine::unitKey(item)].push_back({ it.key(), &item });
+
+    for (const Edit& e : m_edits) {
+        const auto items = byKey.value(e.key);
+        if (items.isEmpty()) {
+            ++report.missing;
+            continue;
+        }
+        for (const auto& at : items) {
+            const qint32 now = fieldValue(*at.second, e.field);
+            if (now == e.after) continue;
+            if (now != e.before)
+                report.conflicts << QString("%1: %2 %3").arg(at.first, e.key, QString::fromLatin1(fieldName(e.field)));
+            setFieldValue(*at.second, e.field, e.after);
+            ++report.applied;
+        }
+    }
+    return report;
+}
+
+void EditJournal::forget(const QSet<QString>& keys) {
+    if (!isOpen() || keys.isEmpty()) return;
+    const auto saved = [&keys](const Edit& e) { return keys.contains(e.key); };
+    if (std::none_of(m_edits.cbegin(), m_edits.cend(), saved)) return;
+    m_edits.erase(std::remove_if(m_edits.begin(), m_edits.end(), saved), m_edits.end());
+    rewrite();
+    m_compactAt = std::max(kCompactBytes, 2 * m_file.size());
+}
+
+// Folds every run of edits of one field of one unit into a single edit,
+// dropping those that end where they started.
+void EditJournal::compact() {
+    QVector<Edit> folded;
+    QHash<QPair<QString, int>, int> at;
+    for (const Edit& e : m_edits) {
+        const QPair<QString, int> k(e.key, int(e.field));
+        const auto it = at.constFind(k);
+        if (it == at.constEnd()) {
+            at.insert(k, int(folded.size()));
+            folded.push_back(e);
+        }
+        else {
+            folded[it.value()].after = e.after;
+        }
+    }
+    folded.erase(std::remove_if(folded.begin(), folded.end(), [](const Edit& e) { return e.before == e.after; }),
+        folded.end());
+
+    m_edits = folded;
+    rewrite();
+    m_compactAt = std::max(kCompactBytes, 2 * m_file.size());
+}
+
+// The whole journal from m_edits, through a rename so a crash keeps either
+// version, then reopened for appends.
+bool EditJournal::rewrite() {
+    const QString path = m_file.fileName();
+    m_file.close();
+    QByteArray out = encodeHeader(m_master);
+    for (const Edit& e : m_edits) out += encodeEdit(e);
+    if (FileCommit::write(path, out) == FileCommit::Failed) return false;
+    return m_file.open(QIODevice::ReadWrite) && m_file.seek(m_file.size());
+}
@@ -0,0 +1,76 @@
+// EditJournal.h
+#pragma once
+
+#include <QFile>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "SidebarEngine.h"
+
+// Append-only record of the item edits made since the master was last
+// saved, so a crash does not lose them.
+//
+// Each accepted edit appends one small binary record per changed field
+// (canonical unit key, field, old and new value) and flushes it to the OS,
+// which costs a few microseconds and outlives the process. On the next
+// start the records are replayed over the tabs built from the master. A
+// record cut short by a crash fails its checksum and is dropped with
+// anything after it. When the file grows, repeated edits of one field are
+// folded into one record and the file is rewritten.
+//
+// File: "SBEJ", version byte, master path (u16 length + UTF-8), then
+// records: u16 payload length, payload (field u8, old i32, new i32, key
+// u16 length + Latin-1), FNV-1a of the payload (u32); little-endian.
+class EditJournal {
+public:
+    // The fields EditPurchaseItemDialog edits.
+    enum Field : quint8 {
+        Cost = 1,
+        TechLevel,
+        SpecialTechNumber,
+        UnitLimit,
+        Factory,
+        TechBuilding,
+        FactoryNotRequired,
+    };
+    struct Edit {
+        QString key;        // SidebarEngine::unitKey
+        Field field = Cost;
+        qint32 before = 0;
+        qint32 after = 0;
+    };
+    struct ReplayReport {
+        int applied = 0;         // fields set
+        int missing = 0;         // edits of units not in the tabs
+        QStringList conflicts;   // "Allied Vehicles: 1234_ COST": the master changed it too; the edit won
+    };
+
+    // Opens the journal of this master, reading the edits it holds. A
+    // journal left by another master is kept aside as "<path>.other" and a
+    // new one is started. False if the file cannot be written.
+    bool open(const QString& path, const QString& masterPath, QString* error = nullptr);
+    bool isOpen() const { return m_file.isOpen(); }
+
+    // Appends the fields `after` changes relative to `before`. Returns how
+    // many were recorded.
+    int record(const PurchaseItem& before, const PurchaseItem& after);
+    // Applies the edits, in order, to every item of the unit.
+    ReplayReport replay(TabLists& tabs) const;
+    // The edits of these units (SidebarEngine::unitKey) are saved: drops
+    // them and rewrites the file. Edits of other units stay for a later
+    // update.
+    void forget(const QSet<QString>& keys);
+
+    const QVector<Edit>& edits() const { return m_edits; }
+
+private:
+    bool rewrite();
+    void compact();
+
+    QFile m_file;
+    QString m_master;
+    QVector<Edit> m_edits;
+    qint64 m_compactAt = 0;   // file size that triggers the next compaction
+};
@@ -0,0 +1,43 @@
+// FileCommit.cpp
+#include "FileCommit.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+
+bool FileCommit::matchesDisk(const QString& path, const QByteArray& content) {
+    const QFileInfo fi(path);
+    if (!fi.exists() || fi.size() != content.size()) return false;
+
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+
+    // Compare in chunks so a mismatch near the start stops early
+    const qint64 chunk = 256 * 1024;
+    qint64 pos = 0;
+    while (pos < content.size()) {
+        const QByteArray part = f.read(chunk);
+        if (part.isEmpty() || pos + part.size() > content.size()) return false;
+        if (std::memcmp(part.constData(), content.constData() + pos, size_t(part.size())) != 0) return false;
+        pos += part.size();
+    }
+    return f.atEnd();
+}
+
+FileCommit::Result FileCommit::write(const QString& path, const QByteArray& content, QString* error) {
+    if (matchesDisk(path, content)) return Unchanged;
+
+    QDir().mkpath(QFileInfo(path).path());
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (error) *error = f.errorString();
+        return Failed;
+    }
+    if (f.write(content) != content.size() || !f.commit()) {
+        if (error) *error = f.errorString();
+        f.cancelWriting();
+        return Failed;
+    }
+    return Written;
+}
@@ -0,0 +1,23 @@
+// FileCommit.h
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+// Whole-file writes for everything the editor saves under LevelEdit.
+//
+// A write first compares the new bytes with what is on disk (size, then
+// content) and does nothing if they match, so unchanged files keep their
+// mtime. Otherwise the bytes go to a temporary file next to the target that
+// is flushed and renamed over it (QSaveFile), so a crash leaves either the
+// old file or the new one, never a truncated mix.
+class FileCommit {
+public:
+    enum Result { Unchanged, Written, Failed };
+
+    // Creates the parent directory if needed. *error gets the reason on Failed.
+    static Result write(const QString& path, const QByteArray& content, QString* error = nullptr);
+
+    // True if path exists and holds exactly `content`.
+    static bool matchesDisk(const QString& path, const QByteArray& content);
+};
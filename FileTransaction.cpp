@@ -0,0 +1,219 @@
+// FileTransaction.cpp
+#include "FileTransaction.h"
+#include "FileCommit.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+
+const char* const kStaging = "staging";
+const char* const kCommitting = "committing";
+// Long enough to ride out another run settling or finishing its journal
+const int kLockWaitMs = 2000;
+
+// Only a dead owner makes the lock stale: a batch may run for longer
+// than any fixed age.
+std::unique_ptr<QLockFile> lockJournal(const QString& journalPath) {
+    auto lock = std::make_unique<QLockFile>(journalPath + ".lock");
+    lock->setStaleLockTime(0);
+    if (!lock->tryLock(kLockWaitMs)) return nullptr;
+    return lock;
+}
+
+QString lockOwner(const QString& journalPath) {
+    qint64 pid = 0;
+    QString host, app;
+    if (!QLockFile(journalPath + ".lock").getLockInfo(&pid, &host, &app)) return "another process";
+    return QString("%1 (pid %2 on %3)").arg(app.isEmpty() ? QString("another process") : app).arg(pid).arg(host);
+}
+
+} // namespace
+
+FileTransaction::FileTransaction(const QString& journalPath)
+    : m_journalPath(journalPath) {
+}
+
+FileTransaction::~FileTransaction() {
+    rollback();
+}
+
+bool FileTransaction::stage(const QString& path, const QByteArray& content) {
+    const QString target = QFileInfo(path).absoluteFilePath();
+
+    // A second write to the same file replaces the first
+    const Entry* entry = nullptr;
+    for (const Entry& e : m_files)
+        if (e.target == target) entry = &e;
+
+    if (!entry) {
+        if (FileCommit::matchesDisk(target, content)) return false;
+        // The first write takes the journal for this batch
+        if (!m_lock) {
+            if (!m_stageError.isEmpty()) return false;   // the lock was refused already
+            m_lock = lockJournal(m_journalPath);
+            if (!m_lock) {
+                m_stageError = QString("%1 is in use by %2").arg(m_journalPath, lockOwner(m_journalPath));
+                return false;
+            }
+        }
+        Entry e;
+        e.target = target;
+        e.staged = target + ".sbe-new";
+        e.backup = QFile::exists(target) ? target + ".sbe-old" : QString();
+        if (!e.backup.isEmpty()) QFile::remove(e.backup);   // leftover from an older run
+        m_files.push_back(e);
+        entry = &m_files.last();
+
+        // Known to recover() before it exists, so a crash cannot orphan it
+        if (!writeJournal(m_journalPath, kStaging, m_files) && m_stageError.isEmpty())
+            m_stageError = QString("cannot write journal %1").arg(m_journalPath);
+    }
+
+    QString err;
+    if (FileCommit::write(entry->staged, content, &err) == FileCommit::Failed && m_stageError.isEmpty())
+        m_stageError = QString("%1: %2").arg(entry->staged, err);
+    return true;
+}
+
+QStringList FileTransaction::targets() const {
+    QStringList out;
+    for (const Entry& e : m_files) out << e.target;
+    return out;
+}
+
+void FileTransaction::rollback() {
+    for (const Entry& e : m_files) QFile::remove(e.staged);
+    release();
+    m_files.clear();
+    m_stageError.clear();
+}
+
+// Drops the journal and lets go of it; a batch that never got the lock
+// must not touch the journal of the one that has it.
+void FileTransaction::release() {
+    if (!m_lock) return;
+    QFile::remove(m_journalPath);
+    m_lock.reset();
+}
+
+// Journal layout:
+// { "state": "staging" | "committing",
+//   "files": [ { "target": "...", "staged": "...", "backup": "..." }, ... ] }
+bool FileTransaction::writeJournal(const QString& journalPath, const char* state, const QVector<Entry>& files) {
+    QJsonArray arr;
+    for (const Entry& e : files) {
+        QJsonObject o;
+        o["target"] = e.target;
+        o["staged"] = e.staged;
+        o["backup"] = e.backup;
+        arr.append(o);
+    }
+    QJsonObject top;
+    top["state"] = QString::fromLatin1(state);
+    top["files"] = arr;
+    return FileCommit::write(journalPath, QJsonDocument(top).toJson(QJsonDocument::Indented)) != FileCommit::Failed;
+}
+
+// Puts every target back the way it was before the batch, whatever point
+// the commit reached. Entries not yet swapped still have no backup file.
+void FileTransaction::undo(const QVector<Entry>& files) {
+    for (int i = int(files.size()) - 1; i >= 0; --i) {
+        const Entry& e = files[i];
+        if (!e.backup.isEmpty()) {
+            if (QFile::exists(e.backup)) {
+                QFile::remove(e.target);
+                if (!QFile::rename(e.backup, e.target))
+                    qWarning() << "FileTransaction: cannot restore" << e.target << "from" << e.backup;
+            }
+        }
+        else if (!QFile::exists(e.staged)) {
+            QFile::remove(e.target);   // file was created by this batch
+        }
+        QFile::remove(e.staged);
+    }
+}
+
+bool FileTransaction::commit(QString* error) {
+    auto fail = [&](const QString& why) {
+        undo(m_files);
+        release();
+        m_files.clear();
+        m_stageError.clear();
+        if (error) *error = why;
+        return false;
+    };
+
+    // The staged copies are already on disk, next to each target
+    if (!m_stageError.isEmpty()) return fail(m_stageError);
+    if (m_files.isEmpty()) return true;
+
+    // Swap them in. From here the journal decides recovery.
+    if (!writeJournal(m_journalPath, kCommitting, m_files))
+        return fail(QString("cannot write journal %1").arg(m_journalPath));
+    for (const Entry& e : m_files) {
+        if (!e.backup.isEmpty() && !QFile::rename(e.target, e.backup))
+            return fail(QString("cannot move %1 aside").arg(e.target));
+        if (!QFile::rename(e.staged, e.target))
+            return fail(QString("cannot move %1 into place").arg(e.staged));
+    }
+
+    // Everything is in; drop the old copies and the journal
+    for (const Entry& e : m_files)
+        if (!e.backup.isEmpty()) QFile::remove(e.backup);
+    release();
+    m_files.clear();
+    return true;
+}
+
+FileTransaction::Recovery FileTransaction::recover(const QString& journalPath, QString* report) {
+    if (!QFile::exists(journalPath)) return Clean;
+
+    // A journal whose batch is still running is not a crash
+    const std::unique_ptr<QLockFile> lock = lockJournal(journalPath);
+    if (!lock) {
+        if (report) *report = lockOwner(journalPath);
+        return Busy;
+    }
+    QFile f(journalPath);
+    if (!f.exists()) return Clean;   // the batch finished while we waited
+    if (!f.open(QIODevice::ReadOnly)) return Failed;
+    const QJsonObject top = QJsonDocument::fromJson(f.readAll()).object();
+    f.close();
+
+    QVector<Entry> files;
+    QStringList targets;
+    for (const QJsonValue& v : top.value("files").toArray()) {
+        const QJsonObject o = v.toObject();
+        Entry e;
+        e.target = o.value("target").toString();
+        e.staged = o.value("staged").toString();
+        e.backup = o.value("backup").toString();
+        if (e.target.isEmpty() || e.staged.isEmpty()) continue;
+        files.push_back(e);
+        targets << e.target;
+    }
+    if (report) *report = targets.join('\n');
+
+    // Finished only if the swap got through every file
+    bool allSwapped = top.value("state").toString() == QLatin1String(kCommitting);
+    for (const Entry& e : files)
+        if (QFile::exists(e.staged)) allSwapped = false;
+
+    Recovery result = RolledBack;
+    if (allSwapped) {
+        for (const Entry& e : files)
+            if (!e.backup.isEmpty()) QFile::remove(e.backup);
+        result = Finished;
+    }
+    else {
+        undo(files);
+    }
+
+    if (!QFile::remove(journalPath)) return Failed;
+    return result;
+}
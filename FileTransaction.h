@@ -0,0 +1,67 @@
+// FileTransaction.h
+#pragma once
+
+#include <QByteArray>
+#include <QLockFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+// All-or-nothing update of a batch of files.
+//
+// stage() writes each new content next to its target ("<target>.sbe-new")
+// straight away, so a long batch holds no file contents in memory and no
+// target changes before commit(). Every staged path is in the journal
+// before its file is written. Commit marks the batch as committing, then
+// swaps the staged files in with a burst of renames, keeping each previous
+// file as "<target>.sbe-old" until the whole batch is in. If any step fails
+// the batch is undone. If the process dies while staging or committing,
+// recover() on the next launch reads the journal and either finishes the
+// batch (all renames done) or undoes it, staged copies included.
+//
+// From its first staged write until commit or rollback a batch holds a
+// lock file next to the journal ("<journal>.lock"), so two processes (or
+// two runs) never share a journal and recover() leaves a live batch alone.
+// A batch that cannot take the lock fails at commit(). Not thread-safe:
+// stage from one thread.
+class FileTransaction {
+public:
+    explicit FileTransaction(const QString& journalPath);
+    ~FileTransaction();   // discards anything not committed
+
+    // Queues a write. Content identical to the file on disk is dropped
+    // (returns false) so untouched files keep their mtime. A staging write
+    // that fails makes commit() fail.
+    bool stage(const QString& path, const QByteArray& content);
+    int size() const { return int(m_files.size()); }
+    // The files staged so far, absolute.
+    QStringList targets() const;
+
+    // Applies every staged write or none of them.
+    bool commit(QString* error = nullptr);
+    // Drops the staged writes without touching any target.
+    void rollback();
+
+    enum Recovery { Clean, Finished, RolledBack, Failed, Busy };
+    // Completes or undoes a batch left behind by a crash. *report lists
+    // the affected files; with Busy, a live process is running the batch
+    // and *report names it.
+    static Recovery recover(const QString& journalPath, QString* report = nullptr);
+
+private:
+    struct Entry {
+        QString target;
+        QString staged;
+        QString backup;    // empty when the target did not exist
+    };
+
+    static bool writeJournal(const QString& journalPath, const char* state, const QVector<Entry>& files);
+    static void undo(const QVector<Entry>& files);
+    void release();
+
+    QString m_journalPath;
+    QVector<Entry> m_files;
+    QString m_stageError;   // first failed staging write
+    std::unique_ptr<QLockFile> m_lock;   // held while the batch owns the journal
+};
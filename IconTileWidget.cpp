@@ -1,5 +1,6 @@
 // IconTileWidget.cpp
 #include "IconTileWidget.h"
+#include "TaskScheduler.h"
 #include <QVBoxLayout>
 #include <QLabel>
 #include <QPainter>
@@ -14,9 +15,17 @@
 #include <QIcon>
 #include <QSize>
 #include <QCoreApplication> 
+#include <QHash>
+#include <QPointer>
+#include <QSet>
 
 namespace {
     constexpr int kIconSize = 160;   // bump tile icon size
+
+    // .png paths being converted and the tiles waiting for each, and the
+    // ones texconv could not produce. GUI thread only.
+    QHash<QString, QVector<QPointer<IconTileWidget>>> waitingForIcon;
+    QSet<QString> failedIcons;
 }
 
 // ctor
@@ -51,21 +60,42 @@ QPixmap IconTileWidget::loadTexture(const QString& textureName) {
     QPixmap pix(pngPath);
     if (!pix.isNull()) return pix;
 
-    // Convert .dds -> .png at a larger size
-    if (QFile::exists(ddsPath)) {
-        QString exe = "texconv.exe";
-        // -w/-h set output size; adjust if you want even bigger
-        QStringList args = { "-y", "-ft", "png", "-w", "256", "-h", "256", "-o", cacheDir, ddsPath };
-        QProcess::execute(exe, args);
-
-        QPixmap converted(pngPath);
-        if (!converted.isNull()) return converted;
+    // Convert .dds -> .png at a larger size, off the GUI thread; the tile
+    // is blank until the icon is in the cache
+    if (QFile::exists(ddsPath) && !failedIcons.contains(pngPath)) {
+        convertInBackground(ddsPath, cacheDir, pngPath);
+        QPixmap pending(kIconSize, kIconSize);
+        pending.fill(Qt::transparent);
+        return pending;
     }
 
     qWarning() << "Failed to load or convert texture:" << textureName;
     return QPixmap(kIconSize, kIconSize); // blank fallback at the right size
 }
 
+// One texconv run per texture however many tiles show it, queued ahead of
+// batch work on the shared scheduler. The tiles still around when it is
+// done load the icon again.
+void IconTileWidget::convertInBackground(const QString& ddsPath, const QString& cacheDir, const QString& pngPath) {
+    QVector<QPointer<IconTileWidget>>& tiles = waitingForIcon[pngPath];
+    if (!tiles.contains(this)) tiles << this;
+    if (tiles.size() > 1) return;   // already queued
+
+    TaskScheduler::instance().post(TaskScheduler::Interactive, [ddsPath, cacheDir, pngPath]() {
+        QString exe = "texconv.exe";
+        // -w/-h set output size; adjust if you want even bigger
+        QStringList args = { "-y", "-ft", "png", "-w", "256", "-h", "256", "-o", cacheDir, ddsPath };
+        QProcess::execute(exe, args);
+        const bool ok = QFile::exists(pngPath);
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [pngPath, ok]() {
+            if (!ok) failedIcons.insert(pngPath);
+            for (const QPointer<IconTileWidget>& tile : waitingForIcon.take(pngPath))
+                if (tile) tile->updateIcon();
+            }, Qt::QueuedConnection);
+        });
+}
+
 void IconTileWidget::updateIcon() {
     QString tex = baseItem.texture;
     if (currentAltIndex >= 0 && currentAltIndex < baseItem.altTextures.size()) {
@@ -32,5 +32,6 @@ private:
     QString iconDir;
 
     QPixmap loadTexture(const QString& textureName);
+    void convertInBackground(const QString& ddsPath, const QString& cacheDir, const QString& pngPath);
     void updateIcon();
 };
@@ -0,0 +1,30 @@
+// JobControl.h
+#pragma once
+
+#include <atomic>
+
+// Shared between a long operation running on a worker thread and whoever
+// started it. The caller asks it to stop with cancel() and may poll the
+// counters (e.g. from a timer) to show progress; the operation checks
+// isCancelled() between units of work and stops before committing anything.
+// All members are lock-free and safe to use from any thread.
+class JobControl {
+public:
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+    // Units of work in all, units done so far, and how many of those
+    // actually changed something.
+    void setTotal(int total) { m_total.store(total, std::memory_order_relaxed); }
+    void advance(int n = 1) { m_done.fetch_add(n, std::memory_order_relaxed); }
+    void addChanged(int n = 1) { m_changed.fetch_add(n, std::memory_order_relaxed); }
+    int total() const { return m_total.load(std::memory_order_relaxed); }
+    int done() const { return m_done.load(std::memory_order_relaxed); }
+    int changed() const { return m_changed.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> m_cancelled{ false };
+    std::atomic<int> m_total{ 0 };
+    std::atomic<int> m_done{ 0 };
+    std::atomic<int> m_changed{ 0 };
+};
@@ -0,0 +1,437 @@
+// JsonCst.cpp
+#include "JsonCst.h"
+#include "JsonStructuralIndex.h"
+#include <cstring>
+
+namespace {
+
+constexpr int kMaxDepth = 512;
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Ends a bare literal (number / true / false / null).
+inline bool isDelimiter(char c) {
+    return isSpace(c) || c == ',' || c == ':' || c == '{' || c == '}' || c == '[' || c == ']' ||
+        c == '"' || c == '/';
+}
+
+bool isNumber(const char* s, int n) {
+    int i = 0;
+    if (i < n && s[i] == '-') ++i;
+    const int intStart = i;
+    while (i < n && s[i] >= '0' && s[i] <= '9') ++i;
+    if (i == intStart) return false;
+    if (i < n && s[i] == '.') {
+        const int fracStart = ++i;
+        while (i < n && s[i] >= '0' && s[i] <= '9') ++i;
+        if (i == fracStart) return false;
+    }
+    if (i < n && (s[i] == 'e' || s[i] == 'E')) {
+        ++i;
+        if (i < n && (s[i] == '+' || s[i] == '-')) ++i;
+        const int expStart = i;
+        while (i < n && s[i] >= '0' && s[i] <= '9') ++i;
+        if (i == expStart) return false;
+    }
+    return i == n;
+}
+
+// Whitespace after the last newline of s[0, n); false if there is no newline.
+bool indentAfterLastNewline(const char* s, int n, QByteArray& indent) {
+    int nl = n - 1;
+    while (nl >= 0 && s[nl] != '\n') --nl;
+    if (nl < 0) return false;
+    int j = nl + 1;
+    while (j < n && (s[j] == ' ' || s[j] == '\t')) ++j;
+    indent = QByteArray(s + nl + 1, j - nl - 1);
+    return true;
+}
+
+} // namespace
+
+// Builds nodes for one JSON value (plus surrounding trivia) into a JsonCst.
+//
+// Stage 1 is the SIMD structural index, used here to find where each string
+// ends without looking at its bytes. Stage 2 walks the text, records the
+// trivia between tokens and links up the nodes. A comment can hide quotes
+// the index would pair up, so once one is seen strings are scanned directly.
+class JsonCstParser {
+public:
+    JsonCstParser(JsonCst& doc, const QByteArray& text, int base, bool own)
+        : m_doc(doc), m_s(text.constData()), m_n(int(text.size())), m_base(base), m_own(own),
+        m_index(text) {}
+
+    JsonCst::Node run(QString* error) {
+        // A UTF-8 BOM opening a document stays in the root's leading trivia
+        const bool bom = !m_own && m_n >= 3 && std::memcmp(m_s, "\xEF\xBB\xBF", 3) == 0;
+        int i = skipTrivia(bom ? 3 : 0);
+        const JsonCst::Node n = newNode();
+        if (i >= 0) {
+            rec(n).pre = slice(0, i);
+            if (value(n, i, 0)) {
+                const int j = skipTrivia(i);
+                if (j == m_n) {
+                    rec(n).post = slice(i, j);
+                    return n;
+                }
+                if (j >= 0) fail(j, "unexpected data after the document");
+            }
+        }
+        if (error) *error = m_error;
+        return -1;
+    }
+
+private:
+    JsonCst::Rec& rec(JsonCst::Node n) { return m_doc.m_nodes[n]; }
+
+    JsonCst::Node newNode() {
+        m_doc.m_nodes.push_back(JsonCst::Rec{});
+        return JsonCst::Node(m_doc.m_nodes.size() - 1);
+    }
+
+    JsonCst::Slice slice(int from, int to) const {
+        return JsonCst::Slice{ m_base + from, to - from, m_own };
+    }
+
+    bool fail(int at, const char* what) {
+        if (m_error.isEmpty()) m_error = QStringLiteral("offset %1: %2").arg(at).arg(QLatin1String(what));
+        return false;
+    }
+
+    // First byte at or after i that is not whitespace or a comment; -1 on an
+    // unterminated comment.
+    int skipTrivia(int i) {
+        while (i < m_n) {
+            if (isSpace(m_s[i])) { ++i; continue; }
+            if (m_s[i] != '/' || i + 1 >= m_n) break;
+            if (m_s[i + 1] == '/') {
+                m_useIndex = false;
+                i += 2;
+                while (i < m_n && m_s[i] != '\n') ++i;
+            }
+            else if (m_s[i + 1] == '*') {
+                m_useIndex = false;
+                int j = i + 2;
+                while (j + 1 < m_n && !(m_s[j] == '*' && m_s[j + 1] == '/')) ++j;
+                if (j + 1 >= m_n) { fail(i, "unterminated comment"); return -1; }
+                i = j + 2;
+            }
+            else {
+                break;
+            }
+        }
+        return i;
+    }
+
+    // Offset just past the closing quote of the string opening at i, or -1.
+    int stringEnd(int i) {
+        if (m_useIndex) {
+            while (m_k < m_index.size() && m_index.at(m_k) < i) ++m_k;
+            if (m_k < m_index.size() && m_index.at(m_k) == i && m_index.kind(m_k) == '"') {
+                const int p = m_index.partner(m_k);
+                if (p >= 0) return m_index.at(p) + 1;
+            }
+        }
+        for (int j = i + 1; j < m_n; ++j) {
+            if (m_s[j] == '\\') { ++j; continue; }
+            if (m_s[j] == '"') return j + 1;
+        }
+        fail(i, "unterminated string");
+        return -1;
+    }
+
+    bool value(JsonCst::Node n, int& i, int depth) {
+        if (i >= m_n) return fail(i, "expected a value");
+        const char c = m_s[i];
+        if (c == '{' || c == '[') return container(n, i, depth);
+        if (c == '"') {
+            const int e = stringEnd(i);
+            if (e < 0) return false;
+            rec(n).kind = JsonCst::String;
+            rec(n).token = slice(i, e);
+            i = e;
+            return true;
+        }
+
+        int e = i;
+        while (e < m_n && !isDelimiter(m_s[e])) ++e;
+        const int len = e - i;
+        JsonCst::Kind k;
+        if ((len == 4 && std::memcmp(m_s + i, "true", 4) == 0) ||
+            (len == 5 && std::memcmp(m_s + i, "false", 5) == 0))
+            k = JsonCst::Bool;
+        else if (len == 4 && std::memcmp(m_s + i, "null", 4) == 0)
+            k = JsonCst::Null;
+        else if (len > 0 && isNumber(m_s + i, len))
+            k = JsonCst::Number;
+        else
+            return fail(i, "expected a value");
+        rec(n).kind = k;
+        rec(n).token = slice(i, e);
+        i = e;
+        return true;
+    }
+
+    bool container(JsonCst::Node n, int& i, int depth) {
+        if (depth >= kMaxDepth) return fail(i, "nesting too deep");
+        const bool isObject = m_s[i] == '{';
+        const char close = isObject ? '}' : ']';
+        rec(n).kind = isObject ? JsonCst::Object : JsonCst::Array;
+
+        int c = i + 1;
+        int j = skipTrivia(c);
+        if (j < 0) return false;
+        if (j < m_n && m_s[j] == close) {
+            rec(n).token = slice(c, j);
+            i = j + 1;
+            return true;
+        }
+
+        while (true) {
+            const JsonCst::Node child = newNode();
+            m_doc.attach(n, child);
+            rec(child).pre = slice(c, j);
+
+            if (isObject) {
+                if (j >= m_n || m_s[j] != '"') return fail(j, "expected a key");
+                const int keyEnd = stringEnd(j);
+                if (keyEnd < 0) return false;
+                const int colon = skipTrivia(keyEnd);
+                if (colon < 0) return false;
+                if (colon >= m_n || m_s[colon] != ':') return fail(colon, "expected ':'");
+                const int v = skipTrivia(colon + 1);
+                if (v < 0) return false;
+                rec(child).key = slice(j, keyEnd);
+                rec(child).colon = slice(keyEnd, v);
+                j = v;
+            }
+
+            if (!value(child, j, depth + 1)) return false;
+            const int t = skipTrivia(j);
+            if (t < 0) return false;
+            rec(child).post = slice(j, t);
+
+            if (t < m_n && m_s[t] == ',') {
+                c = t + 1;
+                j = skipTrivia(c);
+                if (j < 0) return false;
+                continue;
+            }
+            if (t < m_n && m_s[t] == close) {
+                i = t + 1;
+                return true;
+            }
+            return fail(t, isObject ? "expected ',' or '}'" : "expected ',' or ']'");
+        }
+    }
+
+    JsonCst& m_doc;
+    const char* m_s;
+    int m_n;
+    int m_base;
+    bool m_own;
+    JsonStructuralIndex m_index;
+    int m_k = 0;
+    bool m_useIndex = true;
+    QString m_error;
+};
+
+bool JsonCst::parse(const QByteArray& utf8, QString* error) {
+    m_src = utf8;
+    m_own.clear();
+    m_nodes.clear();
+    m_modified = false;
+    m_root = JsonCstParser(*this, m_src, 0, false).run(error);
+    if (m_root < 0) {
+        m_src.clear();
+        m_nodes.clear();
+        return false;
+    }
+    return true;
+}
+
+QByteArray JsonCst::serialize() const {
+    QByteArray out;
+    if (m_root < 0) return out;
+    out.reserve(m_src.size() + m_own.size());
+    const Rec& r = m_nodes.at(m_root);
+    out.append(data(r.pre), r.pre.len);
+    write(m_root, out);
+    out.append(data(r.post), r.post.len);
+    return out;
+}
+
+void JsonCst::write(Node n, QByteArray& out) const {
+    const Rec& r = m_nodes.at(n);
+    if (r.kind != Array && r.kind != Object) {
+        out.append(data(r.token), r.token.len);
+        return;
+    }
+    out.append(r.kind == Object ? '{' : '[');
+    for (Node c = r.first; c >= 0; c = m_nodes.at(c).next) {
+        const Rec& cr = m_nodes.at(c);
+        if (c != r.first) out.append(',');
+        out.append(data(cr.pre), cr.pre.len);
+        out.append(data(cr.key), cr.key.len);
+        out.append(data(cr.colon), cr.colon.len);
+        write(c, out);
+        out.append(data(cr.post), cr.post.len);
+    }
+    if (r.count == 0) out.append(data(r.token), r.token.len);
+    out.append(r.kind == Object ? '}' : ']');
+}
+
+const char* JsonCst::data(const Slice& s) const {
+    return (s.own ? m_own.constData() : m_src.constData()) + s.pos;
+}
+
+QByteArray JsonCst::bytes(const Slice& s) const {
+    return QByteArray(data(s), s.len);
+}
+
+JsonCst::Slice JsonCst::own(const QByteArray& b) {
+    const Slice s{ int(m_own.size()), int(b.size()), true };
+    m_own.append(b);
+    return s;
+}
+
+void JsonCst::attach(Node parentNode, Node n) {
+    Rec& p = m_nodes[parentNode];
+    Rec& r = m_nodes[n];
+    r.parent = parentNode;
+    r.prev = p.last;
+    r.next = -1;
+    if (p.last >= 0) m_nodes[p.last].next = n;
+    else p.first = n;
+    p.last = n;
+    ++p.count;
+}
+
+JsonCst::Node JsonCst::child(Node n, int i) const {
+    if (n < 0 || i < 0) return -1;
+    Node c = m_nodes.at(n).first;
+    while (c >= 0 && i-- > 0) c = m_nodes.at(c).next;
+    return c;
+}
+
+JsonCst::Node JsonCst::member(Node object, const char* key) const {
+    if (object < 0 || m_nodes.at(object).kind != Object) return -1;
+    const int len = int(std::strlen(key));
+    for (Node c = m_nodes.at(object).first; c >= 0; c = m_nodes.at(c).next) {
+        const Slice& k = m_nodes.at(c).key;
+        if (k.len == len + 2 && std::memcmp(data(k) + 1, key, size_t(len)) == 0) return c;
+    }
+    return -1;
+}
+
+JsonCst::Node JsonCst::path(Node from, std::initializer_list<const char*> keys) const {
+    Node n = from;
+    for (const char* k : keys) {
+        n = member(n, k);
+        if (n < 0) break;
+    }
+    return n;
+}
+
+QByteArray JsonCst::text(Node n) const {
+    QByteArray out;
+    if (n >= 0) write(n, out);
+    return out;
+}
+
+int JsonCst::toInt(Node n, int defaultValue) const {
+    if (n < 0 || m_nodes.at(n).kind != Number) return defaultValue;
+    const QByteArray lit = bytes(m_nodes.at(n).token);
+    bool ok = false;
+    const int v = lit.toInt(&ok);
+    if (ok) return v;
+    const double d = lit.toDouble(&ok);
+    return ok ? int(d) : defaultValue;
+}
+
+bool JsonCst::toBool(Node n, bool defaultValue) const {
+    if (n < 0 || m_nodes.at(n).kind != Bool) return defaultValue;
+    return *data(m_nodes.at(n).token) == 't';
+}
+
+QString JsonCst::toString(Node n) const {
+    if (n < 0 || m_nodes.at(n).kind != String) return QString();
+    const Slice& t = m_nodes.at(n).token;
+    return JsonStructuralIndex::unescape(data(t) + 1, t.len - 2);
+}
+
+QByteArray JsonCst::indentOf(Node n) const {
+    for (Node m = n; m >= 0; m = m_nodes.at(m).parent) {
+        const Slice& pre = m_nodes.at(m).pre;
+        QByteArray indent;
+        if (indentAfterLastNewline(data(pre), pre.len, indent)) return indent;
+    }
+    return QByteArray();
+}
+
+QByteArray JsonCst::elementIndent(Node container) const {
+    const Rec& r = m_nodes.at(container);
+    const Slice& lead = r.first >= 0 ? m_nodes.at(r.first).pre : r.token;
+    QByteArray indent;
+    if (indentAfterLastNewline(data(lead), lead.len, indent))
+        return r.first >= 0 ? indent : indent + '\t';
+    return indentOf(container) + '\t';
+}
+
+JsonCst::Node JsonCst::parseFragment(const QByteArray& valueText) {
+    const int base = int(m_own.size());
+    m_own.append(valueText);
+    return JsonCstParser(*this, valueText, base, true).run(nullptr);
+}
+
+bool JsonCst::replace(Node n, const QByteArray& valueText) {
+    if (n < 0) return false;
+    const Node f = parseFragment(valueText);
+    if (f < 0) return false;
+
+    const Rec src = m_nodes.at(f);
+    Rec& r = m_nodes[n];
+    r.kind = src.kind;
+    r.token = src.token;
+    r.first = src.first;
+    r.last = src.last;
+    r.count = src.count;
+    for (Node c = r.first; c >= 0; c = m_nodes.at(c).next) m_nodes[c].parent = n;
+    m_modified = true;
+    return true;
+}
+
+JsonCst::Node JsonCst::appendElement(Node array, const QByteArray& valueText) {
+    if (array < 0 || m_nodes.at(array).kind != Array) return -1;
+
+    // Work out the separators before the arena grows
+    Slice pre, post, lastPost;
+    const Node last = m_nodes.at(array).last;
+    if (last < 0) {
+        const Slice inner = m_nodes.at(array).token;
+        QByteArray endIndent;
+        if (!indentAfterLastNewline(data(inner), inner.len, endIndent)) endIndent = indentOf(array);
+        pre = own("\n" + elementIndent(array));
+        post = own("\n" + endIndent);
+    }
+    else {
+        // New element takes the last one's place; the last one now ends like its predecessor
+        const Rec& lr = m_nodes.at(last);
+        pre = lr.pre;
+        post = lr.post;
+        if (lr.prev >= 0) lastPost = m_nodes.at(lr.prev).post;
+    }
+
+    const Node f = parseFragment(valueText);
+    if (f < 0) return -1;
+
+    if (last < 0) m_nodes[array].token = Slice{};
+    else m_nodes[last].post = lastPost;
+    m_nodes[f].pre = pre;
+    m_nodes[f].post = post;
+    attach(array, f);
+    m_modified = true;
+    return f;
+}
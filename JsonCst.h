@@ -0,0 +1,97 @@
+// JsonCst.h
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <initializer_list>
+
+// Lossless concrete syntax tree for the LevelEdit JSON files.
+//
+// Every input byte ends up either in a token (bracket, key, literal) or in
+// the trivia around it (whitespace, // and /* */ comments), and the tree
+// keeps both, so serialize() gives back an untouched document byte for
+// byte. Nodes live in one arena and refer to each other by index; their
+// text is a slice of the source buffer. Edits append new bytes to a second
+// buffer and repoint slices, so a mutation costs O(changed nodes) and every
+// other line keeps its exact formatting.
+class JsonCst {
+public:
+    using Node = int;   // arena index; -1 = none
+    enum Kind : quint8 { Null, Bool, Number, String, Array, Object };
+
+    // Replaces the contents. On failure the document is empty and *error
+    // (if given) says where parsing stopped.
+    bool parse(const QByteArray& utf8, QString* error = nullptr);
+    QByteArray serialize() const;
+
+    bool isNull() const { return m_root < 0; }
+    bool isModified() const { return m_modified; }
+
+    // --- navigation ---
+    Node root() const { return m_root; }
+    Kind kind(Node n) const { return m_nodes.at(n).kind; }
+    Node parent(Node n) const { return m_nodes.at(n).parent; }
+    int childCount(Node n) const { return n < 0 ? 0 : m_nodes.at(n).count; }
+    Node firstChild(Node n) const { return n < 0 ? -1 : m_nodes.at(n).first; }
+    Node nextSibling(Node n) const { return m_nodes.at(n).next; }
+    Node child(Node n, int i) const;
+
+    // First direct member of an object with this key, or -1.
+    Node member(Node object, const char* key) const;
+    // member(member(...)) down a chain of keys; -1 as soon as one is missing.
+    Node path(Node from, std::initializer_list<const char*> keys) const;
+
+    // --- values ---
+    QByteArray text(Node n) const;   // the value as written (subtree for containers)
+    int toInt(Node n, int defaultValue = 0) const;
+    bool toBool(Node n, bool defaultValue = false) const;
+    QString toString(Node n) const;  // decoded; empty unless n is a string
+
+    // --- layout ---
+    // Leading whitespace of the line the node starts on.
+    QByteArray indentOf(Node n) const;
+    // Indent a new element of this container should use.
+    QByteArray elementIndent(Node container) const;
+
+    // --- mutation ---
+    // Replaces the value of n with valueText (one JSON value). The node keeps
+    // its key and surrounding trivia. False if valueText does not parse.
+    bool replace(Node n, const QByteArray& valueText);
+    // Appends valueText as the last element of an array. Separator trivia is
+    // copied from the existing elements so the new one lines up with them;
+    // leading/trailing whitespace of valueText is dropped. Returns the new node.
+    Node appendElement(Node array, const QByteArray& valueText);
+
+private:
+    friend class JsonCstParser;
+
+    struct Slice {
+        int pos = 0;
+        int len = 0;
+        bool own = false;   // in m_own rather than m_src
+    };
+    struct Rec {
+        Kind kind = Null;
+        Node parent = -1, first = -1, last = -1, next = -1, prev = -1;
+        int count = 0;
+        Slice pre;     // trivia before the member (after '{', '[' or ',')
+        Slice key;     // object members: the quoted key
+        Slice colon;   // object members: trivia, ':' and trivia before the value
+        Slice token;   // scalars: the literal; empty containers: trivia between the brackets
+        Slice post;    // trivia after the value, up to ',' or the closing bracket
+    };
+
+    const char* data(const Slice& s) const;
+    QByteArray bytes(const Slice& s) const;
+    Slice own(const QByteArray& b);
+    Node parseFragment(const QByteArray& valueText);
+    void attach(Node parentNode, Node n);
+    void write(Node n, QByteArray& out) const;
+
+    QByteArray m_src;
+    QByteArray m_own;
+    QVector<Rec> m_nodes;
+    Node m_root = -1;
+    bool m_modified = false;
+};
@@ -0,0 +1,219 @@
+// JsonProjection.cpp
+#include "JsonProjection.h"
+#include "JsonStructuralIndex.h"
+#include <QFile>
+#include <climits>
+#include <cstring>
+
+// One scan of one text. Recursion follows the compiled paths only, so it
+// is as deep as the longest path, whatever the nesting of the document.
+class JsonProjection::Walker {
+public:
+    Walker(const JsonProjection& p, const QByteArray& text, const Callback& onMatch)
+        : m_steps(p.m_steps), m_text(text), m_data(text.constData()), m_size(int(text.size())), m_onMatch(onMatch) {}
+
+    bool run(QString* error) {
+        // A leading UTF-8 BOM, as QJsonDocument::fromJson allows
+        if (m_size >= 3 && std::memcmp(m_data, "\xEF\xBB\xBF", 3) == 0) m_pos = 3;
+        skipSpace();
+        const bool ok = value(0, -1);
+        if (!ok && error) *error = QString("malformed JSON near offset %1").arg(m_pos);
+        return ok;
+    }
+
+private:
+    void skipSpace() {
+        while (m_pos < m_size) {
+            const char c = m_data[m_pos];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+            ++m_pos;
+        }
+    }
+
+    // From an opening quote to just past the closing one.
+    bool skipString() {
+        int at = m_pos + 1;
+        for (;;) {
+            const void* q = std::memchr(m_data + at, '"', size_t(m_size - at));
+            if (!q) return false;
+            at = int(static_cast<const char*>(q) - m_data);
+            int slashes = 0;
+            while (at - 1 - slashes > m_pos && m_data[at - 1 - slashes] == '\\') ++slashes;
+            ++at;
+            if (slashes % 2 == 0) break;
+        }
+        m_pos = at;
+        return true;
+    }
+
+    // Past one value of any kind; brackets go through the SIMD matcher.
+    bool skipValue() {
+        if (m_pos >= m_size) return false;
+        const char c = m_data[m_pos];
+        if (c == '"') return skipString();
+        if (c == '{' || c == '[') {
+            const int close = JsonStructuralIndex::findMatchingClose(m_text, m_pos);
+            if (close < 0) return false;
+            m_pos = close + 1;
+            return true;
+        }
+        const int start = m_pos;
+        while (m_pos < m_size) {
+            const char d = m_data[m_pos];
+            if (d == ',' || d == '}' || d == ']' || d == ' ' || d == '\t' || d == '\n' || d == '\r') break;
+            ++m_pos;
+        }
+        return m_pos > start;
+    }
+
+    bool expect(char c) {
+        skipSpace();
+        if (m_pos >= m_size || m_data[m_pos] != c) return false;
+        ++m_pos;
+        return true;
+    }
+
+    // The value at m_pos, reached through `step`.
+    bool value(int step, int record) {
+        const Step& s = m_steps.at(step);
+        if (m_pos >= m_size) return false;
+        const char c = m_data[m_pos];
+        const int start = m_pos;
+
+        bool ok;
+        if (c == '{' && !s.members.isEmpty()) ok = object(s, record);
+        else if (c == '[' && s.elements >= 0) ok = array(s.elements, record);
+        else ok = skipValue();
+
+        if (ok && s.path >= 0) m_onMatch(s.path, record, Value{ m_data + start, m_pos - start });
+        return ok;
+    }
+
+    bool object(const Step& s, int record) {
+        ++m_pos;   // {
+        skipSpace();
+        if (m_pos < m_size && m_data[m_pos] == '}') { ++m_pos; return true; }
+        for (;;) {
+            skipSpace();
+            if (m_pos >= m_size || m_data[m_pos] != '"') return false;
+            const int keyStart = m_pos + 1;
+            if (!skipString()) return false;
+            const int keyLen = m_pos - 1 - keyStart;
+            if (!expect(':')) return false;
+            skipSpace();
+
+            int next = -1;
+            for (const auto& m : s.members) {
+                if (m.first.size() == keyLen && std::memcmp(m.first.constData(), m_data + keyStart, size_t(keyLen)) == 0) {
+                    next = m.second;
+                    break;
+                }
+            }
+            if (!(next >= 0 ? value(next, record) : skipValue())) return false;
+
+            skipSpace();
+            if (m_pos >= m_size) return false;
+            const char c = m_data[m_pos++];
+            if (c == '}') return true;
+            if (c != ',') return false;
+        }
+    }
+
+    bool array(int elementStep, int record) {
+        ++m_pos;   // [
+        skipSpace();
+        if (m_pos < m_size && m_data[m_pos] == ']') { ++m_pos; return true; }
+        for (int i = 0;; ++i) {
+            skipSpace();
+            if (!value(elementStep, record < 0 ? i : record)) return false;
+            skipSpace();
+            if (m_pos >= m_size) return false;
+            const char c = m_data[m_pos++];
+            if (c == ']') return true;
+            if (c != ',') return false;
+        }
+    }
+
+    const QVector<Step>& m_steps;
+    const QByteArray& m_text;
+    const char* m_data;
+    int m_size;
+    const Callback& m_onMatch;
+    int m_pos = 0;
+};
+
+JsonProjection::JsonProjection(const QStringList& paths) {
+    addStep();   // root
+    for (int p = 0; p < paths.size(); ++p) {
+        int step = 0;
+        // "A[*].B.C" -> A, [*], B, C
+        QString spec = paths.at(p);
+        spec.replace("[*]", ".[*]");
+        for (const QString& part : spec.split('.')) {
+            if (part.isEmpty()) continue;
+            if (part == "[*]") {
+                if (m_steps[step].elements < 0) {
+                    const int next = addStep();
+                    m_steps[step].elements = next;
+                }
+                step = m_steps[step].elements;
+                continue;
+            }
+            const QByteArray key = part.toUtf8();
+            int next = -1;
+            for (const auto& m : m_steps[step].members)
+                if (m.first == key) next = m.second;
+            if (next < 0) {
+                next = addStep();
+                m_steps[step].members.push_back({ key, next });
+            }
+            step = next;
+        }
+        m_steps[step].path = p;
+    }
+}
+
+int JsonProjection::addStep() {
+    m_steps.push_back(Step());
+    return int(m_steps.size()) - 1;
+}
+
+bool JsonProjection::scan(const QByteArray& utf8, const Callback& onMatch, QString* error) const {
+    return Walker(*this, utf8, onMatch).run(error);
+}
+
+bool JsonProjection::scanFile(const QString& path, const Callback& onMatch, QString* error) const {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString("cannot open %1").arg(path);
+        return false;
+    }
+    // An empty file cannot be mapped; it is not JSON either
+    const qint64 size = f.size();
+    uchar* mapped = size > 0 && size < INT_MAX ? f.map(0, size) : nullptr;
+    if (!mapped) return scan(f.readAll(), onMatch, error);
+
+    const QByteArray text = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), int(size));
+    const bool ok = scan(text, onMatch, error);
+    f.unmap(mapped);
+    return ok;
+}
+
+// ----- Value -----
+
+int JsonProjection::Value::toInt(int defaultValue) const {
+    const qint64 v = toInt64(defaultValue);
+    return v >= INT_MIN && v <= INT_MAX ? int(v) : defaultValue;
+}
+
+qint64 JsonProjection::Value::toInt64(qint64 defaultValue) const {
+    if (size <= 0) return defaultValue;
+    bool ok = false;
+    const qint64 v = QByteArray::fromRawData(data, size).toLongLong(&ok);
+    return ok ? v : defaultValue;
+}
+
+QString JsonProjection::Value::toString() const {
+    if (!isString()) return QString();
+    return JsonStructuralIndex::unescape(data + 1, size - 2);
+}
@@ -0,0 +1,55 @@
+// JsonProjection.h
+#pragma once
+
+#include <QByteArray>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+// Reads a few paths out of a JSON text without building a document.
+//
+// The paths are compiled once into a trie ("GlobalSettings[*].DEF_ID",
+// "GlobalSettings[*].FACTORY_WRAPPER.DATA.DEFINITION_BASE.ID", ...; [*] is
+// every element of an array). A scan walks only the members on some path;
+// any other value is skipped whole, objects and arrays through the
+// structural index's bracket matcher, so an ID scan costs little more than
+// reading the file. Matched values are handed to a callback as spans of
+// the input; nothing is allocated unless the callback decodes one.
+class JsonProjection {
+public:
+    // One matched value: its raw JSON text (a string keeps its quotes).
+    struct Value {
+        const char* data = nullptr;
+        int size = 0;
+
+        bool isString() const { return size >= 2 && data[0] == '"'; }
+        bool isNumber() const { return size > 0 && (data[0] == '-' || (data[0] >= '0' && data[0] <= '9')); }
+        int toInt(int defaultValue = 0) const;
+        qint64 toInt64(qint64 defaultValue = 0) const;
+        QString toString() const;   // decoded; empty unless a string
+    };
+    // path: index into the compiled list. record: index of the element
+    // under the path's first [*], so values of one array element can be
+    // put together; -1 if the path has no [*].
+    using Callback = std::function<void(int path, int record, const Value& value)>;
+
+    explicit JsonProjection(const QStringList& paths);
+
+    // False if the text is not well-formed as far as it was walked.
+    bool scan(const QByteArray& utf8, const Callback& onMatch, QString* error = nullptr) const;
+    // Maps the file rather than reading it in.
+    bool scanFile(const QString& path, const Callback& onMatch, QString* error = nullptr) const;
+
+private:
+    class Walker;
+    struct Step {
+        QVector<QPair<QByteArray, int>> members;   // key -> step
+        int elements = -1;                         // [*] -> step
+        int path = -1;                             // a path ends here
+    };
+    int addStep();
+
+    QVector<Step> m_steps;   // m_steps[0] is the root
+};
@@ -0,0 +1,185 @@
+// JsonStreamWriter.cpp
+#include "JsonStreamWriter.h"
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLocale>
+#include <cmath>
+#include <cstring>
+
+JsonStreamWriter::JsonStreamWriter(QIODevice* sink, int bufferSize)
+    : m_sink(sink), m_cap(bufferSize > 0 ? bufferSize : 4096) {
+    m_buf.reserve(m_cap);
+}
+
+JsonStreamWriter::~JsonStreamWriter() {
+    flush();
+}
+
+bool JsonStreamWriter::flush() {
+    if (!m_buf.isEmpty()) {
+        if (m_ok && m_sink->write(m_buf) != m_buf.size()) m_ok = false;
+        m_buf.clear();
+    }
+    return m_ok;
+}
+
+void JsonStreamWriter::put(const char* s, int n) {
+    if (m_buf.size() + n > m_cap) {
+        flush();
+        if (n > m_cap) {   // larger than the whole buffer: write through
+            if (m_ok && m_sink->write(s, n) != n) m_ok = false;
+            return;
+        }
+    }
+    m_buf.append(s, n);
+}
+
+void JsonStreamWriter::put(char c) {
+    if (m_buf.size() + 1 > m_cap) flush();
+    m_buf.append(c);
+}
+
+void JsonStreamWriter::putString(const QString& s) {
+    static const char hex[] = "0123456789abcdef";
+    const QByteArray utf8 = s.toUtf8();
+    put('"');
+    int run = 0;   // start of the pending unescaped run
+    for (int i = 0; i < utf8.size(); ++i) {
+        const unsigned char c = uchar(utf8.at(i));
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        put(utf8.constData() + run, i - run);
+        run = i + 1;
+        switch (c) {
+        case '"':  put("\\\"", 2); break;
+        case '\\': put("\\\\", 2); break;
+        case '\n': put("\\n", 2); break;
+        case '\r': put("\\r", 2); break;
+        case '\t': put("\\t", 2); break;
+        case '\b': put("\\b", 2); break;
+        case '\f': put("\\f", 2); break;
+        default: {
+            const char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            put(u, 6);
+        }
+        }
+    }
+    put(utf8.constData() + run, int(utf8.size()) - run);
+    put('"');
+}
+
+// Separator, newline, indent and key of the next member.
+void JsonStreamWriter::member(const char* key) {
+    if (!m_counts.isEmpty()) {
+        if (m_counts.last()++ > 0) put(',');
+        put('\n');
+        for (int i = 0; i < m_counts.size(); ++i) put('\t');
+    }
+    if (key) {
+        put('"');
+        put(key, int(std::strlen(key)));
+        put("\": ", 3);
+    }
+}
+
+void JsonStreamWriter::open(const char* key, char bracket) {
+    member(key);
+    put(bracket);
+    m_counts.push_back(0);
+}
+
+void JsonStreamWriter::close(char bracket) {
+    const int n = m_counts.takeLast();
+    if (n > 0) {
+        put('\n');
+        for (int i = 0; i < m_counts.size(); ++i) put('\t');
+    }
+    put(bracket);
+    if (m_counts.isEmpty()) put('\n');   // end of document
+}
+
+void JsonStreamWriter::beginObject(const char* key) { open(key, '{'); }
+void JsonStreamWriter::endObject() { close('}'); }
+void JsonStreamWriter::beginArray(const char* key) { open(key, '['); }
+void JsonStreamWriter::endArray() { close(']'); }
+
+void JsonStreamWriter::value(const char* key, int v) {
+    member(key);
+    put(QByteArray::number(v));
+}
+
+void JsonStreamWriter::value(const char* key, bool v) {
+    member(key);
+    if (v) put("true", 4);
+    else put("false", 5);
+}
+
+void JsonStreamWriter::value(const char* key, const QString& v) {
+    member(key);
+    putString(v);
+}
+
+void JsonStreamWriter::value(const char* key, const QJsonValue& v) {
+    member(key);
+    writeValue(v);
+}
+
+void JsonStreamWriter::writeValue(const QJsonValue& v) {
+    switch (v.type()) {
+    case QJsonValue::Bool:
+        if (v.toBool()) put("true", 4);
+        else put("false", 5);
+        break;
+    case QJsonValue::Double: {
+        const double d = v.toDouble();
+        if (std::isfinite(d) && d == std::floor(d) && std::fabs(d) < 9007199254740992.0)
+            put(QByteArray::number(qint64(d)));
+        else if (std::isfinite(d))
+            put(QByteArray::number(d, 'g', QLocale::FloatingPointShortest));
+        else
+            put("null", 4);
+        break;
+    }
+    case QJsonValue::String:
+        putString(v.toString());
+        break;
+    case QJsonValue::Array:
+        put('[');
+        m_counts.push_back(0);
+        for (const QJsonValue& e : v.toArray()) {
+            member(nullptr);
+            writeValue(e);
+        }
+        close(']');
+        break;
+    case QJsonValue::Object: {
+        put('{');
+        m_counts.push_back(0);
+        const QJsonObject o = v.toObject();
+        for (auto it = o.constBegin(); it != o.constEnd(); ++it) {
+            member(nullptr);
+            putString(it.key());
+            put(": ", 2);
+            writeValue(it.value());
+        }
+        close('}');
+        break;
+    }
+    default:
+        put("null", 4);
+        break;
+    }
+}
+
+void JsonStreamWriter::intArray3(const char* key, const QVector<int>& xs) {
+    beginArray(key);
+    for (int i = 0; i < 3; ++i) value(nullptr, xs.value(i, 0));
+    endArray();
+}
+
+void JsonStreamWriter::stringArray3(const char* key, const QVector<QString>& xs) {
+    beginArray(key);
+    for (int i = 0; i < 3; ++i) value(nullptr, xs.value(i));
+    endArray();
+}
@@ -0,0 +1,58 @@
+// JsonStreamWriter.h
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class QIODevice;
+class QJsonValue;
+
+// Indented JSON written straight to a device, LevelEdit style: one member
+// per line, tab indentation, "KEY": value, empty containers as [] / {}.
+//
+// Output goes through a fixed-size buffer that is flushed to the sink when
+// full, so memory stays at the buffer size however large the document is
+// and nothing is built up front. Callers open and close containers in
+// order; a key is given for object members and omitted (nullptr) for
+// array elements.
+class JsonStreamWriter {
+public:
+    explicit JsonStreamWriter(QIODevice* sink, int bufferSize = 64 * 1024);
+    ~JsonStreamWriter();   // flushes
+
+    void beginObject(const char* key = nullptr);
+    void endObject();
+    void beginArray(const char* key = nullptr);
+    void endArray();
+
+    void value(const char* key, int v);
+    void value(const char* key, bool v);
+    void value(const char* key, const QString& v);
+    void value(const char* key, const QJsonValue& v);   // any subtree
+    void value(const char* key, const char* v) = delete; // would pick the bool overload
+
+    // Always exactly three elements, missing ones as 0 / "".
+    void intArray3(const char* key, const QVector<int>& xs);
+    void stringArray3(const char* key, const QVector<QString>& xs);
+
+    // Pushes buffered bytes to the sink; false once any write failed.
+    bool flush();
+    bool ok() const { return m_ok; }
+
+private:
+    void member(const char* key);
+    void open(const char* key, char bracket);
+    void close(char bracket);
+    void put(const char* s, int n);
+    void put(const QByteArray& b) { put(b.constData(), int(b.size())); }
+    void put(char c);
+    void putString(const QString& s);
+    void writeValue(const QJsonValue& v);
+
+    QIODevice* m_sink;
+    QByteArray m_buf;
+    int m_cap;
+    QVector<int> m_counts;   // members written so far, per open container
+    bool m_ok = true;
+};
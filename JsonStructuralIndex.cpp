@@ -0,0 +1,332 @@
+// JsonStructuralIndex.cpp
+#include "JsonStructuralIndex.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <iterator>
+
+#if (defined(_M_X64) && !defined(_M_ARM64EC)) || defined(__x86_64__)
+#define SB_X86_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SB_TARGET_AVX2
+#else
+#define SB_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define SB_X86_SIMD 0
+#endif
+
+namespace {
+
+// One 64-byte block, one bit per byte.
+struct BlockMasks {
+    quint64 quote = 0;
+    quint64 backslash = 0;
+    quint64 open = 0;   // { [
+    quint64 close = 0;  // } ]
+    quint64 sep = 0;    // : ,
+};
+
+#if !SB_X86_SIMD
+// Reference kernel; used where no SIMD is available.
+void classifyScalar(const char* p, BlockMasks& m) {
+    m = BlockMasks{};
+    for (int i = 0; i < 64; ++i) {
+        const quint64 bit = quint64(1) << i;
+        switch (p[i]) {
+        case '"':  m.quote |= bit; break;
+        case '\\': m.backslash |= bit; break;
+        case '{': case '[': m.open |= bit; break;
+        case '}': case ']': m.close |= bit; break;
+        case ':': case ',': m.sep |= bit; break;
+        default: break;
+        }
+    }
+}
+#endif
+
+#if SB_X86_SIMD
+// '{' / '[' and '}' / ']' differ only in bit 0x20, so one compare after
+// OR-ing 0x20 catches both brackets of a kind.
+void classifySse2(const char* p, BlockMasks& m) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i fold = _mm_set1_epi8(0x20);
+
+    m = BlockMasks{};
+    for (int i = 0; i < 4; ++i) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+        const __m128i folded = _mm_or_si128(v, fold);
+        const int shift = 16 * i;
+        m.quote |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+        m.backslash |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << shift;
+        m.open |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(folded, open)))) << shift;
+        m.close |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(folded, close)))) << shift;
+        m.sep |= quint64(quint16(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma))))) << shift;
+    }
+}
+
+SB_TARGET_AVX2 void classifyAvx2(const char* p, BlockMasks& m) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i fold = _mm256_set1_epi8(0x20);
+
+    m = BlockMasks{};
+    for (int i = 0; i < 2; ++i) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i));
+        const __m256i folded = _mm256_or_si256(v, fold);
+        const int shift = 32 * i;
+        m.quote |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)))) << shift;
+        m.backslash |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)))) << shift;
+        m.open |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, open)))) << shift;
+        m.close |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, close)))) << shift;
+        m.sep |= quint64(quint32(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma))))) << shift;
+    }
+}
+
+bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+    int regs[4] = {};
+    __cpuid(regs, 0);
+    if (regs[0] < 7) return false;
+    __cpuid(regs, 1);
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    const bool avx = (regs[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;   // OS saves XMM+YMM state
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+using ClassifyFn = void (*)(const char*, BlockMasks&);
+
+ClassifyFn pickKernel() {
+#if SB_X86_SIMD
+    if (cpuHasAvx2()) return &classifyAvx2;
+    return &classifySse2;
+#else
+    return &classifyScalar;
+#endif
+}
+
+inline void classify(const char* p, BlockMasks& m) {
+    static const ClassifyFn kernel = pickKernel();
+    kernel(p, m);
+}
+
+// Carried between blocks: whether the block ends inside a string, and
+// whether its last code unit is an unfinished escape.
+struct StringState {
+    quint64 prevEscaped = 0;
+    quint64 prevInString = 0;
+};
+
+// Bits of code units preceded by an odd run of backslashes (simdjson's
+// branchless escape finder).
+inline quint64 findEscaped(quint64 backslash, quint64& prevEscaped) {
+    const quint64 evenBits = 0x5555555555555555ULL;
+    backslash &= ~prevEscaped;
+    const quint64 followsEscape = (backslash << 1) | prevEscaped;
+    const quint64 oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+    const quint64 sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+    prevEscaped = sequencesStartingOnEvenBits < oddSequenceStarts ? 1 : 0;
+    const quint64 invertMask = sequencesStartingOnEvenBits << 1;
+    return (evenBits ^ invertMask) & followsEscape;
+}
+
+inline quint64 prefixXor(quint64 x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Returns the in-string mask (opening quote included, closing excluded)
+// and the unescaped quotes of the block.
+inline quint64 stringMask(const BlockMasks& m, StringState& st, quint64& quotes) {
+    const quint64 escaped = findEscaped(m.backslash, st.prevEscaped);
+    quotes = m.quote & ~escaped;
+    const quint64 inString = prefixXor(quotes) ^ st.prevInString;
+    st.prevInString = quint64(qint64(inString) >> 63);
+    return inString;
+}
+
+// Calls fn(blockOffset, masks) for each 64-unit block of [from, to); the
+// tail is padded with spaces. fn returns false to stop early.
+template <typename Fn>
+void forEachBlock(const char* data, int from, int to, Fn&& fn) {
+    BlockMasks m;
+    int i = from;
+    for (; i + 64 <= to; i += 64) {
+        classify(data + i, m);
+        if (!fn(i, m)) return;
+    }
+    if (i < to) {
+        char pad[64];
+        std::fill(std::begin(pad), std::end(pad), ' ');
+        std::copy(data + i, data + to, pad);
+        classify(pad, m);
+        fn(i, m);
+    }
+}
+
+int streamMatch(const char* data, int size, int openPos) {
+    if (openPos < 0 || openPos >= size) return -1;
+    const char c = data[openPos];
+    if (c != '{' && c != '[') return -1;
+
+    int depth = 0, result = -1;
+    StringState st;
+    forEachBlock(data, openPos, size, [&](int base, const BlockMasks& m) {
+        quint64 quotes = 0;
+        const quint64 inString = stringMask(m, st, quotes);
+        const quint64 opens = m.open & ~inString;
+        const quint64 closes = m.close & ~inString;
+
+        // Not enough closers in this block to get back to zero: skip it whole.
+        const int nClose = int(qPopulationCount(closes));
+        if (depth > nClose) {
+            depth += int(qPopulationCount(opens)) - nClose;
+            return true;
+        }
+        quint64 bits = opens | closes;
+        while (bits) {
+            const quint64 bit = bits & (~bits + 1);
+            depth += (opens & bit) ? 1 : -1;
+            if (depth == 0) {
+                result = base + int(qCountTrailingZeroBits(bit));
+                return false;
+            }
+            bits ^= bit;
+        }
+        return true;
+        });
+    return result;
+}
+
+} // namespace
+
+JsonStructuralIndex::JsonStructuralIndex(const QByteArray& utf8, int from, int to) {
+    build(utf8.constData(), from, to < 0 ? int(utf8.size()) : to);
+}
+
+void JsonStructuralIndex::build(const char* data, int from, int to) {
+    m_pos.clear();
+    m_kind.clear();
+    m_partner.clear();
+    from = std::max(0, from);
+    if (from >= to) return;
+
+    StringState st;
+    forEachBlock(data, from, to, [&](int base, const BlockMasks& m) {
+        quint64 quotes = 0;
+        const quint64 inString = stringMask(m, st, quotes);
+        quint64 bits = ((m.open | m.close | m.sep) & ~inString) | quotes;
+        while (bits) {
+            const int off = base + int(qCountTrailingZeroBits(bits));
+            m_pos.push_back(off);
+            m_kind.append(data[off]);
+            bits &= bits - 1;
+        }
+        return true;
+        });
+
+    // Pair brackets with a stack; quotes simply alternate.
+    m_partner.fill(-1, m_pos.size());
+    QVector<int> stack;
+    int openQuote = -1;
+    for (int k = 0; k < m_pos.size(); ++k) {
+        switch (m_kind.at(k)) {
+        case '"':
+            if (openQuote < 0) openQuote = k;
+            else { m_partner[openQuote] = k; m_partner[k] = openQuote; openQuote = -1; }
+            break;
+        case '{': case '[':
+            stack.push_back(k);
+            break;
+        case '}': case ']':
+            if (!stack.isEmpty()) {
+                const int o = stack.takeLast();
+                m_partner[o] = k;
+                m_partner[k] = o;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+int JsonStructuralIndex::lowerBound(int pos) const {
+    return int(std::lower_bound(m_pos.cbegin(), m_pos.cend(), pos) - m_pos.cbegin());
+}
+
+int JsonStructuralIndex::matchingClose(int openPos) const {
+    const int k = lowerBound(openPos);
+    if (k >= m_pos.size() || m_pos.at(k) != openPos) return -1;
+    const char c = m_kind.at(k);
+    if (c != '{' && c != '[') return -1;
+    const int p = m_partner.at(k);
+    return p < 0 ? -1 : m_pos.at(p);
+}
+
+int JsonStructuralIndex::nextStructural(int pos, char ch) const {
+    for (int k = lowerBound(pos); k < m_pos.size(); ++k) {
+        const char c = m_kind.at(k);
+        if (c == ch) return m_pos.at(k);
+        if (c == '"') k = std::max(k, m_partner.at(k)); // skip to the closing quote
+    }
+    return -1;
+}
+
+int JsonStructuralIndex::findMatchingClose(const QByteArray& utf8, int openPos) {
+    return streamMatch(utf8.constData(), int(utf8.size()), openPos);
+}
+
+QString JsonStructuralIndex::unescape(const char* s, int len) {
+    QString out;
+    int run = 0;   // start of the current unescaped run
+    for (int i = 0; i < len; ++i) {
+        if (s[i] != '\\') continue;
+        out += QString::fromUtf8(s + run, i - run);
+        if (++i >= len) break;
+        switch (s[i]) {
+        case 'b': out += QChar('\b'); break;
+        case 'f': out += QChar('\f'); break;
+        case 'n': out += QChar('\n'); break;
+        case 'r': out += QChar('\r'); break;
+        case 't': out += QChar('\t'); break;
+        case 'u':
+            if (i + 4 < len) {
+                bool ok = false;
+                const ushort u = QByteArray(s + i + 1, 4).toUShort(&ok, 16);
+                if (ok) out += QChar(u);   // surrogate halves pair up on their own
+                i += 4;
+            }
+            break;
+        default: out += QChar(s[i]); break;   // \" \\ \/
+        }
+        run = i + 1;
+    }
+    out += QString::fromUtf8(s + run, len - run);
+    return out;
+}
@@ -0,0 +1,54 @@
+// JsonStructuralIndex.h
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Stage-1 structural index over a JSON text, simdjson style.
+//
+// The input is classified 64 code units at a time into bitmasks (quotes,
+// backslashes, brackets, separators) with SSE2/AVX2 kernels, escapes and
+// string interiors are resolved with bit arithmetic, and what is left are
+// the offsets of every structural character that sits outside a string.
+// Brackets and quotes are paired once, so "where does this object end"
+// becomes a lookup instead of a character walk.
+//
+// Works on the UTF-8 bytes as read from disk; every character we care
+// about is ASCII, and UTF-8 never reuses ASCII values inside a sequence.
+class JsonStructuralIndex {
+public:
+    JsonStructuralIndex() = default;
+    // Index [from, to) of the text; `from` must not be inside a string.
+    explicit JsonStructuralIndex(const QByteArray& utf8, int from = 0, int to = -1);
+
+    int size() const { return m_pos.size(); }
+    // Offset, character and partner entry of the k-th structural.
+    // Partners exist for brackets ({ } [ ]) and quotes (opening <-> closing).
+    int at(int k) const { return m_pos.at(k); }
+    char kind(int k) const { return m_kind.at(k); }
+    int partner(int k) const { return m_partner.at(k); }
+
+    // Index of the first structural at or after `pos` (size() if none).
+    int lowerBound(int pos) const;
+    // Offset of the bracket closing the one at openPos, or -1.
+    int matchingClose(int openPos) const;
+    // First `ch` at or after `pos` that is outside any string, or -1.
+    int nextStructural(int pos, char ch) const;
+
+    // One-shot matcher for text that is about to change anyway: scans from
+    // openPos block by block and stops at the match without building an index.
+    static int findMatchingClose(const QByteArray& utf8, int openPos);
+
+    // Decodes the body of a string literal (the bytes between its quotes):
+    // UTF-8 runs as they are, escapes resolved. The one decoder behind
+    // JsonCst and JsonProjection string values.
+    static QString unescape(const char* s, int len);
+
+private:
+    void build(const char* data, int from, int to);
+
+    QVector<int> m_pos;      // ascending offsets
+    QByteArray   m_kind;     // the character at each offset
+    QVector<int> m_partner;  // paired entry, or -1
+};
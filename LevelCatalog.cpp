@@ -0,0 +1,211 @@
+// LevelCatalog.cpp
+#include "LevelCatalog.h"
+#include "JsonCst.h"
+#include "LevelPresetIndex.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+
+// Long enough to fold a multi-level commit into one rescan
+constexpr int kDebounceMs = 500;
+
+LevelCatalog::FileStamp stampOf(const QString& path) {
+    LevelCatalog::FileStamp s;
+    const QFileInfo fi(path);
+    s.exists = fi.exists();
+    if (s.exists) {
+        s.size = fi.size();
+        s.modified = fi.lastModified();
+    }
+    return s;
+}
+
+bool sameStamp(const LevelCatalog::FileStamp& a, const LevelCatalog::FileStamp& b) {
+    return a.exists == b.exists && a.size == b.size && a.modified == b.modified;
+}
+
+QString presetsPath(const QString& root, const QString& level) {
+    return QString("%1/Database/Levels/%2/Presets/GlobalSettings.json").arg(root, level);
+}
+
+// Section and item counts of a level's Definitions file.
+void readDefinitions(const QString& path, LevelCatalog::Level& level) {
+    level.sections = 0;
+    level.items = 0;
+    level.customSections.clear();
+    level.readable = false;
+
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return;
+    JsonCst doc;
+    QString err;
+    if (!doc.parse(f.readAll(), &err)) {
+        qWarning() << "LevelCatalog: cannot parse" << path << err;
+        return;
+    }
+    level.readable = true;
+
+    const JsonCst::Node gs = doc.member(doc.root(), "GlobalSettings");
+    for (JsonCst::Node e = doc.firstChild(gs); e >= 0; e = doc.nextSibling(e)) {
+        const JsonCst::Node data = doc.path(e, { "FACTORY_WRAPPER", "DATA" });
+        const JsonCst::Node ps = doc.member(data, "PURCHASE_SETTINGS_DEF_CLASS");
+        if (ps < 0) continue;
+        ++level.sections;
+        const JsonCst::Node items = doc.member(ps, "PURCHASE_ITEMS");
+        for (JsonCst::Node it = doc.firstChild(items); it >= 0; it = doc.nextSibling(it)) ++level.items;
+
+        const JsonCst::Node name = doc.path(data, { "DEFINITION_BASE", "NAME" });
+        const QString n = name >= 0 ? doc.toString(name) : QString();
+        if (n.startsWith("Sidebar Editor Custom")) level.customSections << n;
+    }
+}
+
+} // namespace
+
+LevelCatalog::LevelCatalog(QObject* parent)
+    : QObject(parent) {
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(kDebounceMs);
+    connect(&m_debounce, &QTimer::timeout, this, &LevelCatalog::rescan);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, &m_debounce, [this]() { m_debounce.start(); });
+    connect(&m_scan, &QFutureWatcher<Scan>::finished, this, &LevelCatalog::onScanFinished);
+}
+
+void LevelCatalog::setRoot(const QString& levelEditRoot) {
+    if (levelEditRoot == m_root && (m_ready || m_scan.isRunning())) return;
+    m_root = levelEditRoot;
+    m_levels.clear();
+    m_master = FileStamp();
+    m_ready = false;
+    const QStringList watched = m_watcher.directories();
+    if (!watched.isEmpty()) m_watcher.removePaths(watched);
+    emit changed();
+    rescan();
+}
+
+void LevelCatalog::setCamoAssignments(const QMap<QString, QString>& camoByLevel) {
+    m_camo = camoByLevel;
+    emit changed();
+}
+
+QList<LevelCatalog::Level> LevelCatalog::levels() const {
+    QList<Level> out;
+    for (auto it = m_levels.cbegin(); it != m_levels.cend(); ++it) {
+        Level l = it.value();
+        l.camo = m_camo.value(it.key());
+        out << l;
+    }
+    return out;
+}
+
+QStringList LevelCatalog::names() const {
+    return m_levels.keys();
+}
+
+QStringList LevelCatalog::staleLevels() const {
+    QStringList out;
+    for (const Level& l : m_levels) {
+        const bool stale = !l.definitions.exists || !l.presets.exists
+            || (m_master.exists && l.definitions.modified < m_master.modified);
+        if (stale) out << l.name;
+    }
+    return out;
+}
+
+void LevelCatalog::rescan() {
+    if (m_root.isEmpty()) return;
+    if (m_scan.isRunning()) {
+        m_rescanQueued = true;
+        return;
+    }
+    const QString root = m_root;
+    const QMap<QString, Level> previous = m_levels;
+    m_scan.setFuture(QtConcurrent::run([root, previous]() { return scan(root, previous); }));
+}
+
+// Runs on the thread pool. Levels whose Definitions stamp is unchanged keep
+// their counts; the others are parsed again, in parallel.
+LevelCatalog::Scan LevelCatalog::scan(const QString& root, const QMap<QString, Level>& previous) {
+    Scan out;
+    out.root = root;
+    out.master = stampOf(root + "/Database/Global/Definitions/GlobalSettings.json");
+
+    const QDir baseDir(root + "/Database/Levels");
+    const QStringList names = baseDir.entryList(QStringList("RA_*"), QDir::Dirs | QDir::NoDotAndDotDot);
+
+    QVector<Level> reparse;
+    for (const QString& name : names) {
+        Level l;
+        l.name = name;
+        l.definitions = stampOf(LevelPresetIndex::levelFilePath(root, name));
+        l.presets = stampOf(presetsPath(root, name));
+
+        const auto known = previous.constFind(name);
+        if (known != previous.constEnd() && sameStamp(known->definitions, l.definitions)) {
+            l.sections = known->sections;
+            l.items = known->items;
+            l.customSections = known->customSections;
+            l.readable = known->readable;
+            out.levels.insert(name, l);
+        }
+        else if (!l.definitions.exists) {
+            out.levels.insert(name, l);
+        }
+        else {
+            reparse.push_back(l);
+        }
+    }
+
+    QtConcurrent::blockingMap(reparse, [&root](Level& l) {
+        readDefinitions(LevelPresetIndex::levelFilePath(root, l.name), l);
+        });
+    for (const Level& l : reparse) out.levels.insert(l.name, l);
+    return out;
+}
+
+void LevelCatalog::onScanFinished() {
+    const Scan result = m_scan.result();
+    if (result.root == m_root) {
+        m_levels = result.levels;
+        m_master = result.master;
+        m_ready = true;
+        watchLevels();
+        emit changed();
+    }
+    if (m_rescanQueued || result.root != m_root) {
+        m_rescanQueued = false;
+        rescan();
+    }
+}
+
+// The levels folder itself (levels added or removed), each level folder
+// (Definitions/Presets created) and both subfolders. Directories rather than
+// the files: a commit renames a new file into place, which a file watch
+// would not follow.
+void LevelCatalog::watchLevels() {
+    const QString base = m_root + "/Database/Levels";
+    QStringList wanted;
+    if (QFileInfo(base).isDir()) wanted << base;
+    for (const QString& name : m_levels.keys()) {
+        const QString dir = base + "/" + name;
+        wanted << dir;
+        for (const char* sub : { "/Definitions", "/Presets" })
+            if (QFileInfo(dir + sub).isDir()) wanted << dir + sub;
+    }
+
+    const QStringList watched = m_watcher.directories();
+    QStringList gone;
+    for (const QString& d : watched)
+        if (!wanted.contains(d)) gone << d;
+    if (!gone.isEmpty()) m_watcher.removePaths(gone);
+
+    QStringList added;
+    for (const QString& d : wanted)
+        if (!watched.contains(d)) added << d;
+    if (!added.isEmpty()) m_watcher.addPaths(added);
+}
@@ -0,0 +1,80 @@
+// LevelCatalog.h
+#pragma once
+
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QMap>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+// What the level pickers know about each RA_* level under Database/Levels,
+// kept current in the background.
+//
+// setRoot() starts a scan on the thread pool; after that a file system
+// watcher on the levels folder and every level's Definitions and Presets
+// folders triggers a rescan shortly after something changes. A rescan only
+// stats the files; a level's Definitions file is parsed again only if its
+// size or mtime moved. levels() never touches the disk, so a picker can
+// open at once and show, sort and filter on whatever has been scanned.
+class LevelCatalog : public QObject {
+    Q_OBJECT
+public:
+    struct FileStamp {
+        bool exists = false;
+        qint64 size = 0;
+        QDateTime modified;
+    };
+    struct Level {
+        QString name;
+        FileStamp definitions;
+        FileStamp presets;
+        int sections = 0;               // purchase sections in Definitions
+        int items = 0;                  // purchase items over those sections
+        QStringList customSections;     // "Sidebar Editor Custom ..." sections
+        bool readable = true;           // false: Definitions did not parse
+        QString camo;                   // assigned camo, empty if none
+    };
+
+    explicit LevelCatalog(QObject* parent = nullptr);
+
+    // Starts over for another LevelEdit folder.
+    void setRoot(const QString& levelEditRoot);
+    // Camo per level, as assigned in the editor; shown with the levels.
+    void setCamoAssignments(const QMap<QString, QString>& camoByLevel);
+
+    bool isReady() const { return m_ready; }   // the first scan is in
+    QList<Level> levels() const;               // sorted by name
+    QStringList names() const;
+    // Levels an update from the master would change on disk: Definitions
+    // or Presets missing, or Definitions older than the master file.
+    QStringList staleLevels() const;
+
+signals:
+    void changed();   // levels() has new content
+
+private slots:
+    void rescan();
+    void onScanFinished();
+
+private:
+    struct Scan {
+        QString root;
+        QMap<QString, Level> levels;
+        FileStamp master;
+    };
+    static Scan scan(const QString& root, const QMap<QString, Level>& previous);
+    void watchLevels();
+
+    QString m_root;
+    QMap<QString, Level> m_levels;
+    QMap<QString, QString> m_camo;
+    FileStamp m_master;
+    bool m_ready = false;
+
+    QFutureWatcher<Scan> m_scan;
+    bool m_rescanQueued = false;   // something changed while a scan ran
+    QFileSystemWatcher m_watcher;
+    QTimer m_debounce;             // one rescan per burst of changes
+};
@@ -0,0 +1,183 @@
+// LevelPresetIndex.cpp
+#include "LevelPresetIndex.h"
+#include "FileCommit.h"
+#include "JsonProjection.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+
+namespace {
+
+constexpr int kCacheVersion = 1;
+
+} // namespace
+
+LevelPresetIndex::LevelPresetIndex(const QString& cachePath)
+    : m_cachePath(cachePath) {
+    load();
+    rebuildLookup();
+}
+
+QString LevelPresetIndex::levelFilePath(const QString& levelEditRoot, const QString& level) {
+    return QString("%1/Database/Levels/%2/Definitions/GlobalSettings.json").arg(levelEditRoot, level);
+}
+
+// Only TEAM, TYPE and the PRESET_IDs are read; everything else in the
+// file is skipped without being parsed.
+bool LevelPresetIndex::scanLevel(const QString& path, LevelEntry& entry) {
+    static const JsonProjection projection({
+        "GlobalSettings[*].FACTORY_WRAPPER.DATA.PURCHASE_SETTINGS_DEF_CLASS.TEAM",
+        "GlobalSettings[*].FACTORY_WRAPPER.DATA.PURCHASE_SETTINGS_DEF_CLASS.TYPE",
+        "GlobalSettings[*].FACTORY_WRAPPER.DATA.PURCHASE_SETTINGS_DEF_CLASS.PURCHASE_ITEMS[*].PRESET_ID",
+        });
+    // TEAM/TYPE may come after the items, so a section is put together first
+    struct Section {
+        int team = -1;
+        int type = -1;
+        QVector<int> presetIds;
+    };
+    QVector<Section> sections;
+    QString err;
+    const bool ok = projection.scanFile(path, [&sections](int p, int record, const JsonProjection::Value& v) {
+        if (record >= sections.size()) sections.resize(record + 1);
+        Section& s = sections[record];
+        if (p == 0) s.team = v.toInt(-1);
+        else if (p == 1) s.type = v.toInt(-1);
+        else if (v.isNumber()) s.presetIds.push_back(v.toInt());
+        }, &err);
+    if (!ok) {
+        qWarning() << "LevelPresetIndex: cannot parse" << path << err;
+        return false;
+    }
+
+    entry.presets.clear();
+    for (const Section& s : sections)
+        for (int id : s.presetIds) entry.presets.push_back(Location{ id, s.team, s.type });
+    return true;
+}
+
+void LevelPresetIndex::refresh(const QString& levelEditRoot) {
+    bool changed = false;
+    if (levelEditRoot != m_root) {
+        m_levels.clear();
+        m_root = levelEditRoot;
+        changed = true;
+    }
+
+    const QDir baseDir(levelEditRoot + "/Database/Levels");
+    const QStringList maps = baseDir.entryList(QStringList("RA_*"), QDir::Dirs | QDir::NoDotAndDotDot);
+
+    // Drop levels that went away
+    for (auto it = m_levels.begin(); it != m_levels.end();) {
+        if (!maps.contains(it.key())) { it = m_levels.erase(it); changed = true; }
+        else ++it;
+    }
+
+    // Levels whose file is new or has a different stamp get rescanned
+    struct Job {
+        QString level;
+        QString path;
+        LevelEntry entry;
+        bool ok = false;
+    };
+    QVector<Job> jobs;
+    for (const QString& level : maps) {
+        const QFileInfo fi(levelFilePath(levelEditRoot, level));
+        if (!fi.exists()) {
+            if (m_levels.remove(level)) changed = true;
+            continue;
+        }
+        const qint64 mtime = fi.lastModified().toMSecsSinceEpoch();
+        const auto found = m_levels.constFind(level);
+        if (found != m_levels.constEnd() && found->mtime == mtime && found->size == fi.size()) continue;
+
+        Job job;
+        job.level = level;
+        job.path = fi.filePath();
+        job.entry.mtime = mtime;
+        job.entry.size = fi.size();
+        jobs.push_back(job);
+    }
+
+    QtConcurrent::blockingMap(jobs, [](Job& job) { job.ok = scanLevel(job.path, job.entry); });
+
+    for (const Job& job : jobs) {
+        if (job.ok) m_levels.insert(job.level, job.entry);
+        else m_levels.remove(job.level);
+        changed = true;
+    }
+
+    if (changed) {
+        rebuildLookup();
+        save();
+    }
+}
+
+QStringList LevelPresetIndex::levelsContaining(int presetId, int team, int type) const {
+    QStringList out;
+    for (const Hit& h : m_byPresetId.value(presetId)) {
+        if (h.team == team && h.type == type && !out.contains(h.level)) out << h.level;
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+void LevelPresetIndex::rebuildLookup() {
+    m_byPresetId.clear();
+    for (auto it = m_levels.cbegin(); it != m_levels.cend(); ++it) {
+        for (const Location& loc : it->presets)
+            m_byPresetId[loc.presetId].push_back(Hit{ it.key(), loc.team, loc.type });
+    }
+}
+
+// Cache layout:
+// { "version": 1, "root": "...",
+//   "levels": { "RA_X": { "mtime": ..., "size": ..., "presets": [[id, team, type], ...] } } }
+void LevelPresetIndex::load() {
+    QFile f(m_cachePath);
+    if (!f.open(QIODevice::ReadOnly)) return;
+    const QJsonObject top = QJsonDocument::fromJson(f.readAll()).object();
+    f.close();
+    if (top.value("version").toInt() != kCacheVersion) return;
+
+    m_root = top.value("root").toString();
+    const QJsonObject levels = top.value("levels").toObject();
+    for (auto it = levels.constBegin(); it != levels.constEnd(); ++it) {
+        const QJsonObject o = it.value().toObject();
+        LevelEntry entry;
+        entry.mtime = qint64(o.value("mtime").toDouble(-1));
+        entry.size = qint64(o.value("size").toDouble(-1));
+        for (const QJsonValue& v : o.value("presets").toArray()) {
+            const QJsonArray a = v.toArray();
+            entry.presets.push_back(Location{ a.at(0).toInt(), a.at(1).toInt(), a.at(2).toInt() });
+        }
+        m_levels.insert(it.key(), entry);
+    }
+}
+
+void LevelPresetIndex::save() const {
+    QJsonObject levels;
+    for (auto it = m_levels.cbegin(); it != m_levels.cend(); ++it) {
+        QJsonArray presets;
+        for (const Location& loc : it->presets)
+            presets.append(QJsonArray{ loc.presetId, loc.team, loc.type });
+        QJsonObject o;
+        o["mtime"] = double(it->mtime);
+        o["size"] = double(it->size);
+        o["presets"] = presets;
+        levels[it.key()] = o;
+    }
+    QJsonObject top;
+    top["version"] = kCacheVersion;
+    top["root"] = m_root;
+    top["levels"] = levels;
+
+    FileCommit::write(m_cachePath, QJsonDocument(top).toJson(QJsonDocument::Compact));
+}
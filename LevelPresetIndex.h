@@ -0,0 +1,56 @@
+// LevelPresetIndex.h
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Which levels carry which purchase items, across every
+// Database/Levels/<Level>/Definitions/GlobalSettings.json.
+//
+// Each level records the (PRESET_ID, TEAM, TYPE) of every item in its
+// purchase sections plus the file's mtime and size. The table is kept in a
+// small JSON cache between runs; refresh() only rescans the levels whose
+// file stamp moved, in parallel, so a lookup after a balance pass costs a
+// few stat() calls instead of parsing every map again.
+class LevelPresetIndex {
+public:
+    explicit LevelPresetIndex(const QString& cachePath);
+
+    // Brings the table in line with the levels under levelEditRoot and saves
+    // the cache if anything changed. A different root starts from scratch.
+    void refresh(const QString& levelEditRoot);
+
+    // Levels with an item of this PRESET_ID in a TEAM/TYPE section, sorted.
+    QStringList levelsContaining(int presetId, int team, int type) const;
+
+    static QString levelFilePath(const QString& levelEditRoot, const QString& level);
+
+private:
+    struct Location {
+        int presetId = 0;
+        int team = 0;
+        int type = 0;
+    };
+    struct LevelEntry {
+        qint64 mtime = -1;   // ms since epoch
+        qint64 size = -1;
+        QVector<Location> presets;
+    };
+
+    static bool scanLevel(const QString& path, LevelEntry& entry);
+    void load();
+    void save() const;
+    void rebuildLookup();
+
+    QString m_cachePath;
+    QString m_root;
+    QHash<QString, LevelEntry> m_levels;
+    struct Hit {
+        QString level;
+        int team = 0;
+        int type = 0;
+    };
+    QHash<int, QVector<Hit>> m_byPresetId;   // built from m_levels
+};
@@ -0,0 +1,211 @@
+// LineDiff.cpp
+#include "LineDiff.h"
+#include <QHash>
+#include <QVector>
+#include <algorithm>
+
+namespace {
+
+// Lines split after each '\n'; the last one may lack it.
+QVector<QByteArray> splitLines(const QByteArray& text) {
+    QVector<QByteArray> out;
+    int start = 0;
+    while (start < text.size()) {
+        const int nl = text.indexOf('\n', start);
+        const int end = nl < 0 ? int(text.size()) : nl + 1;
+        out.push_back(text.mid(start, end - start));
+        start = end;
+    }
+    return out;
+}
+
+// Myers over line ids. Marks the lines of a that go and the lines of b
+// that come; everything unmarked is common to both.
+struct LineMyers {
+    const QVector<int>& a;
+    const QVector<int>& b;
+    QVector<bool> removed;
+    QVector<bool> inserted;
+
+    LineMyers(const QVector<int>& a_, const QVector<int>& b_)
+        : a(a_), b(b_), removed(a_.size(), false), inserted(b_.size(), false) {}
+
+    void replaceAll(int a0, int a1, int b0, int b1) {
+        for (int i = a0; i < a1; ++i) removed[i] = true;
+        for (int j = b0; j < b1; ++j) inserted[j] = true;
+    }
+
+    // Point on an optimal path through a[a0,a1) x b[b0,b1), found where the
+    // forward and backward searches meet. Both searches keep one furthest-x
+    // per diagonal, which is what makes the whole diff linear in space.
+    bool split(int a0, int a1, int b0, int b1, int& sx, int& sy) const {
+        const int n = a1 - a0, m = b1 - b0;
+        const int maxD = (n + m + 1) / 2;
+        const int off = maxD, len = 2 * maxD + 2;
+        QVector<int> vf(len, -1), vb(len, -1);
+        vf[off + 1] = 0;
+        vb[off + 1] = 0;
+        const int delta = n - m;
+        const bool front = delta % 2 != 0;   // odd: the forward pass detects the overlap
+        int kfStart = 0, kfEnd = 0, kbStart = 0, kbEnd = 0;
+
+        for (int d = 0; d < maxD; ++d) {
+            for (int k = -d + kfStart; k <= d - kfEnd; k += 2) {
+                const int ko = off + k;
+                int x = (k == -d || (k != d && vf[ko - 1] < vf[ko + 1])) ? vf[ko + 1] : vf[ko - 1] + 1;
+                int y = x - k;
+                while (x < n && y < m && a[a0 + x] == b[b0 + y]) { ++x; ++y; }
+                vf[ko] = x;
+                if (x > n) kfEnd += 2;          // ran off the right edge
+                else if (y > m) kfStart += 2;   // ran off the bottom edge
+                else if (front) {
+                    const int kbo = off + delta - k;
+                    if (kbo >= 0 && kbo < len && vb[kbo] != -1 && x >= n - vb[kbo]) {
+                        sx = x; sy = y;
+                        return true;
+                    }
+                }
+            }
+            for (int k = -d + kbStart; k <= d - kbEnd; k += 2) {
+                const int ko = off + k;
+                int x = (k == -d || (k != d && vb[ko - 1] < vb[ko + 1])) ? vb[ko + 1] : vb[ko - 1] + 1;
+                int y = x - k;
+                while (x < n && y < m && a[a1 - 1 - x] == b[b1 - 1 - y]) { ++x; ++y; }
+                vb[ko] = x;
+                if (x > n) kbEnd += 2;
+                else if (y > m) kbStart += 2;
+                else if (!front) {
+                    const int kfo = off + delta - k;
+                    if (kfo >= 0 && kfo < len && vf[kfo] != -1) {
+                        const int fx = vf[kfo];
+                        if (fx >= n - x) {
+                            sx = fx; sy = fx - (kfo - off);
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    void diff(int a0, int a1, int b0, int b1) {
+        // Common head and tail are never part of the edit
+        while (a0 < a1 && b0 < b1 && a[a0] == b[b0]) { ++a0; ++b0; }
+        while (a0 < a1 && b0 < b1 && a[a1 - 1] == b[b1 - 1]) { --a1; --b1; }
+        const int n = a1 - a0, m = b1 - b0;
+        if (n == 0 || m == 0) {
+            replaceAll(a0, a1, b0, b1);
+            return;
+        }
+
+        // One line against many: it either survives somewhere or it does not
+        if (n == 1 || m == 1) {
+            if (n == 1) {
+                const int keep = int(std::find(b.cbegin() + b0, b.cbegin() + b1, a[a0]) - b.cbegin());
+                replaceAll(a0, keep < b1 ? a0 : a1, b0, b1);
+                if (keep < b1) inserted[keep] = false;
+            }
+            else {
+                const int keep = int(std::find(a.cbegin() + a0, a.cbegin() + a1, b[b0]) - a.cbegin());
+                replaceAll(a0, a1, b0, keep < a1 ? b0 : b1);
+                if (keep < a1) removed[keep] = false;
+            }
+            return;
+        }
+
+        int sx = 0, sy = 0;
+        if (!split(a0, a1, b0, b1, sx, sy) || (sx == 0 && sy == 0) || (sx == n && sy == m)) {
+            replaceAll(a0, a1, b0, b1);
+            return;
+        }
+        diff(a0, a0 + sx, b0, b0 + sy);
+        diff(a0 + sx, a1, b0 + sy, b1);
+    }
+};
+
+struct Op {
+    char kind;   // ' ', '-' or '+'
+    int a;       // lines of the old text before this one
+    int b;       // lines of the new text before this one
+};
+
+void appendLine(QByteArray& out, char kind, const QByteArray& line) {
+    out += kind;
+    out += line;
+    if (!line.endsWith('\n')) out += "\n\\ No newline at end of file\n";
+}
+
+} // namespace
+
+QByteArray LineDiff::unified(const QByteArray& before, const QByteArray& after,
+    const QString& label, int context)
+{
+    if (before == after) return QByteArray();
+
+    const QVector<QByteArray> oldLines = splitLines(before);
+    const QVector<QByteArray> newLines = splitLines(after);
+
+    // Compare ids, not bytes
+    QHash<QByteArray, int> ids;
+    auto toIds = [&ids](const QVector<QByteArray>& lines) {
+        QVector<int> out;
+        out.reserve(lines.size());
+        for (const QByteArray& l : lines) {
+            auto it = ids.constFind(l);
+            if (it == ids.constEnd()) it = ids.insert(l, int(ids.size()));
+            out.push_back(it.value());
+        }
+        return out;
+    };
+    const QVector<int> a = toIds(oldLines);
+    const QVector<int> b = toIds(newLines);
+
+    LineMyers myers(a, b);
+    myers.diff(0, int(a.size()), 0, int(b.size()));
+
+    // Edit script, removals before insertions within a change
+    QVector<Op> ops;
+    ops.reserve(a.size() + b.size());
+    for (int i = 0, j = 0; i < a.size() || j < b.size(); ) {
+        if (i < a.size() && myers.removed[i]) ops.push_back(Op{ '-', i++, j });
+        else if (j < b.size() && myers.inserted[j]) ops.push_back(Op{ '+', i, j++ });
+        else ops.push_back(Op{ ' ', i++, j++ });
+    }
+
+    const QByteArray name = label.toUtf8();
+    QByteArray out = "--- a/" + name + "\n+++ b/" + name + "\n";
+    const int n = int(ops.size());
+    for (int i = 0; i < n; ) {
+        if (ops[i].kind == ' ') { ++i; continue; }
+
+        // Grow the hunk over changes closer than two contexts apart
+        const int start = std::max(0, i - context);
+        int end = i;
+        while (end < n) {
+            if (ops[end].kind != ' ') { ++end; continue; }
+            int run = end;
+            while (run < n && ops[run].kind == ' ') ++run;
+            if (run == n || run - end > 2 * context) break;
+            end = run;
+        }
+        const int stop = std::min(n, end + context);
+
+        int oldCount = 0, newCount = 0;
+        for (int k = start; k < stop; ++k) {
+            if (ops[k].kind != '+') ++oldCount;
+            if (ops[k].kind != '-') ++newCount;
+        }
+        // An empty side names the line it would follow
+        const int oldStart = ops[start].a + (oldCount ? 1 : 0);
+        const int newStart = ops[start].b + (newCount ? 1 : 0);
+        out += QString("@@ -%1,%2 +%3,%4 @@\n").arg(oldStart).arg(oldCount).arg(newStart).arg(newCount).toLatin1();
+
+        for (int k = start; k < stop; ++k) {
+            const Op& op = ops[k];
+            appendLine(out, op.kind, op.kind == '+' ? newLines[op.b] : oldLines[op.a]);
+        }
+        i = stop;
+    }
+    return out;
+}
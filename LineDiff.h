@@ -0,0 +1,17 @@
+// LineDiff.h
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+// Line diff of two texts in unified format ("--- a/..", "+++ b/..", "@@"
+// hunks). Uses Myers' O(ND) algorithm in its linear-space form: each step
+// splits the problem at the middle snake, so a diff costs memory in
+// proportion to the two files, not to their length times the edit count.
+// Lines compare byte for byte, line endings included.
+class LineDiff {
+public:
+    // Empty when the texts are equal.
+    static QByteArray unified(const QByteArray& before, const QByteArray& after,
+        const QString& label, int context = 3);
+};
@@ -7,20 +7,17 @@
 #include <QSet>
 #include <QString>
 
+#include "EditJournal.h"
 #include "PurchaseItem.h"
+#include "SidebarEngine.h"
 
+class LevelCatalog;
+class QFileSystemWatcher;
 class QTabWidget;
 class QComboBox;
+class QTimer;
 class QWidget;
 
-struct PurchaseList {
-    QString id;      // e.g. "TEAM=0|TYPE=1|NAME=Vehicles (Allied)"
-    QString name;    // DEFINITION_BASE.NAME
-    int team = 0;
-    int type = 0;
-    QVector<PurchaseItem> items;
-};
-
 class MainWindow : public QMainWindow {
     Q_OBJECT
 
@@ -32,38 +29,53 @@ private:
 
     // Lists chosen by user (built from master) -> used to build tabs
     QMap<QString, QVector<PurchaseItem>> categorizedLists;
+    // The tabs as last built from the master; the base of a reload merge
+    TabLists loadedLists;
 
-    // Source data from master file
-    QVector<PurchaseList> allLists;
+    // Source data from master file, and the document work on it
+    SidebarEngine        engine;
     QSet<QString>        selectedListIds;
+    // Item edits not yet saved to the master, replayed over rebuilt tabs
+    EditJournal          editJournal;
+
+    // Levels under the LevelEdit root, scanned and watched in the background
+    LevelCatalog* levelCatalog = nullptr;
+
+    // The master file on disk, reloaded shortly after it changes
+    QFileSystemWatcher* masterWatcher = nullptr;
+    QTimer* masterReload = nullptr;
+    bool masterJobRunning = false;   // a worker reads the engine's model
 
     // Map name -> dropdown widget (legacy)
     QMap<QString, QComboBox*> mapCamoMap;
 
     // Core logic
+    void recoverInterruptedWrites();
     void loadMasterJson(const QString& path);
     void rebuildFromSelection();             // < NEW
     void buildTabs();
+    void watchMaster();
+    void reloadMasterFromDisk(bool announceConflicts = true);
+    void refreshTabs(const QSet<QString>& labels);
     QWidget* createGridPage(const QVector<PurchaseItem>& items);
-    QString typeTeamToLabel(int type, int team);
     void applyCamoDefaults(const QString& mapTheme);
-    QHash<QString, PurchaseItem> buildEditedMapFromTabs() const;
-    void applyEditsToPurchaseList(PurchaseList& pl, const QHash<QString, PurchaseItem>& edits);
+    void runMasterUpdate(bool selectedOnly);
     void updateMasterFromTabs();
     void updateMasterFromTabsAllLists();
+    void propagateToLevels();
     void mergeIntoLevelDoc(QJsonDocument& levelDoc, const QMap<QString, QVector<PurchaseItem>>& tabs);
     void showLevelPickerAndRun(std::function<void(const QStringList&)> fn);
     void updateSelectedLevels();
-    int computeNextUniqueDefId(const QJsonDocument* currentLevelDoc = nullptr) const;
-    bool reorderCamoInLevelFile(const QString& level, const QString& theme);
-    // File I/O helpers
-    bool loadJsonFromFile(const QString& path, QJsonDocument& outDoc) const;
-    bool writeJsonToFile(const QString& path, const QJsonDocument& doc) const;
+    void planSelectedLevels();
+    SidebarEngine::LevelReport runLevelUpdate(const QStringList& levels, QVector<SidebarEngine::LevelPlan>* plan);
+    void applyCamoToLevelFiles(const QStringList& levels, QWidget* parent);
+    void planCamoForLevelFiles(const QStringList& levels, QWidget* parent);
     QJsonObject itemToJson(const PurchaseItem& item) const;
 
     // Export / Profile tools
     void exportMapJson();
     void exportAllMapJsons();
+    void restoreBackup();
     void showMapTheaterWidget();
     void mergeEditsIntoMasterDoc(QJsonDocument& doc,
         const QHash<QString, PurchaseItem>& edits,
@@ -0,0 +1,106 @@
+// PlanDialog.cpp
+#include "PlanDialog.h"
+#include "LineDiff.h"
+#include <QDialogButtonBox>
+#include <QDir>
+#include <QFontDatabase>
+#include <QFutureWatcher>
+#include <QLabel>
+#include <QListWidget>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QSplitter>
+#include <QVBoxLayout>
+#include <QtConcurrent/QtConcurrentRun>
+
+PlanDialog::PlanDialog(const QString& title, const QVector<Row>& rows, const QString& root, QWidget* parent)
+    : QDialog(parent), m_rows(rows), m_root(root)
+{
+    setWindowTitle(title);
+    resize(1100, 700);
+
+    int changing = 0, failed = 0;
+    for (const Row& r : m_rows) {
+        if (r.failed) ++failed;
+        else if (!r.changes.isEmpty()) ++changing;
+    }
+    auto* summary = new QLabel(QString("%1 levels: %2 would change, %3 unchanged, %4 failed. Nothing has been written yet.")
+        .arg(m_rows.size()).arg(changing).arg(m_rows.size() - changing - failed).arg(failed));
+
+    m_list = new QListWidget;
+    for (const Row& r : m_rows) {
+        auto* item = new QListWidgetItem(QString("%1  (%2)").arg(r.level, r.summary));
+        if (r.failed) item->setForeground(Qt::red);
+        else if (r.changes.isEmpty()) item->setForeground(Qt::gray);
+        m_list->addItem(item);
+    }
+
+    m_view = new QPlainTextEdit;
+    m_view->setReadOnly(true);
+    m_view->setLineWrapMode(QPlainTextEdit::NoWrap);
+    m_view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    auto* split = new QSplitter;
+    split->addWidget(m_list);
+    split->addWidget(m_view);
+    split->setStretchFactor(1, 3);
+
+    // Applying a plan with a failed level would be refused anyway
+    auto* buttons = new QDialogButtonBox;
+    QPushButton* apply = buttons->addButton("Apply", QDialogButtonBox::AcceptRole);
+    buttons->addButton(QDialogButtonBox::Close);
+    apply->setEnabled(failed == 0 && changing > 0);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(m_list, &QListWidget::currentRowChanged, this, &PlanDialog::showRow);
+
+    auto* v = new QVBoxLayout(this);
+    v->addWidget(summary);
+    v->addWidget(split, 1);
+    v->addWidget(buttons);
+    setLayout(v);
+
+    if (!m_rows.isEmpty()) m_list->setCurrentRow(0);
+}
+
+void PlanDialog::showRow(int row) {
+    if (row < 0 || row >= m_rows.size()) {
+        m_view->clear();
+        return;
+    }
+    const Row& r = m_rows.at(row);
+    if (r.failed) {
+        m_view->setPlainText("This level could not be read or patched; see the log.");
+        return;
+    }
+    if (r.changes.isEmpty()) {
+        m_view->setPlainText("No file would change.");
+        return;
+    }
+    const auto done = m_diffs.constFind(row);
+    if (done != m_diffs.constEnd()) {
+        m_view->setPlainText(done.value());
+        return;
+    }
+
+    m_view->setPlainText("Computing diff...");
+    if (m_pending.contains(row)) return;
+    m_pending.insert(row);
+
+    auto* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, row]() {
+        m_diffs.insert(row, watcher->result());
+        m_pending.remove(row);
+        watcher->deleteLater();
+        if (m_list->currentRow() == row) showRow(row);
+        });
+    const QVector<SidebarEngine::FileChange> changes = r.changes;
+    const QString root = m_root;
+    watcher->setFuture(QtConcurrent::run([changes, root]() {
+        const QDir dir(root);
+        QByteArray out;
+        for (const SidebarEngine::FileChange& c : changes)
+            out += LineDiff::unified(c.before, c.after, dir.relativeFilePath(c.path));
+        return QString::fromUtf8(out);
+        }));
+}
@@ -0,0 +1,40 @@
+// PlanDialog.h
+#pragma once
+
+#include <QDialog>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include "SidebarEngine.h"
+
+class QListWidget;
+class QPlainTextEdit;
+
+// Review of a dry run: one row per level with its summary, and the unified
+// diff of the selected level next to it. A level's diff is worked out on the
+// thread pool the first time it is selected, then kept. Accepting the
+// dialog means "apply".
+class PlanDialog : public QDialog {
+    Q_OBJECT
+public:
+    struct Row {
+        QString level;
+        QString summary;
+        QVector<SidebarEngine::FileChange> changes;
+        bool failed = false;
+    };
+
+    // Diff headers name files relative to root.
+    PlanDialog(const QString& title, const QVector<Row>& rows, const QString& root, QWidget* parent = nullptr);
+
+private slots:
+    void showRow(int row);
+
+private:
+    QVector<Row> m_rows;
+    QString m_root;
+    QHash<int, QString> m_diffs;   // finished diffs by row
+    QSet<int> m_pending;           // rows with a diff in the works
+    QListWidget* m_list = nullptr;
+    QPlainTextEdit* m_view = nullptr;
+};
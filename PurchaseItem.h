@@ -22,3 +22,22 @@ struct PurchaseItem {
     QVector<int> altPresetIds;
     QVector<QString> altTextures;
 };
+
+inline bool operator==(const PurchaseItem& a, const PurchaseItem& b) {
+    return a.cost == b.cost && a.presetId == b.presetId && a.stringId == b.stringId
+        && a.texture == b.texture && a.techLevel == b.techLevel
+        && a.team == b.team && a.type == b.type
+        && a.specialTechNumber == b.specialTechNumber && a.unitLimit == b.unitLimit
+        && a.factory == b.factory && a.techBuilding == b.techBuilding
+        && a.factoryNotRequired == b.factoryNotRequired
+        && a.altPresetIds == b.altPresetIds && a.altTextures == b.altTextures;
+}
+inline bool operator!=(const PurchaseItem& a, const PurchaseItem& b) { return !(a == b); }
+
+struct PurchaseList {
+    QString id;      // e.g. "TEAM=0|TYPE=1|NAME=Vehicles (Allied)"
+    QString name;    // DEFINITION_BASE.NAME
+    int team = 0;
+    int type = 0;
+    QVector<PurchaseItem> items;
+};
@@ -0,0 +1,2060 @@
+// SidebarEngine.cpp
+#include "SidebarEngine.h"
+#include "BackupStore.h"
+#include "BoundedQueue.h"
+#include "DatabaseWalker.h"
+#include "FileCommit.h"
+#include "FileTransaction.h"
+#include "JobControl.h"
+#include "JsonCst.h"
+#include "JsonProjection.h"
+#include "JsonStreamWriter.h"
+#include "LevelPresetIndex.h"
+#include "TaskScheduler.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <tuple>
+
+// forward decls for helpers used by updateLevels()
+static JsonCst::Node appendSectionBlock(JsonCst& doc, int defId, const QString& name, int team, int type);
+static QByteArray buildSectionBlockText(int defId, const QString& name, int team, int type,
+    const QByteArray& baseIndent = QByteArrayLiteral("\t\t\t"));
+static bool appendItemToSection(JsonCst& doc, JsonCst::Node section, const PurchaseItem& it);
+static QByteArray jsonQuote(const QString& s);
+// --- Level presets correlation helpers --------------------------------------
+
+struct ParentRef {
+    qint64 parentId = -1;
+    QString parentName;
+};
+
+// DEFINITION_BASE ID/NAME and TEAM/TYPE of every master section, read
+// through a projection instead of a full parse; in file order.
+struct MasterSectionRef {
+    qint64 id = 0;
+    QString name;
+    int team = 0;
+    int type = 0;
+};
+
+static QVector<MasterSectionRef> readMasterSectionRefs(const QString& masterPath) {
+    static const JsonProjection projection({
+        "GlobalSettings[*].FACTORY_WRAPPER.DATA.DEFINITION_BASE.ID",
+        "GlobalSettings[*].FACTORY_WRAPPER.DATA.DEFINITION_BASE.NAME",
+        "GlobalSettings[*].FACTORY_WRAPPER.DATA.PURCHASE_SETTINGS_DEF_CLASS.TEAM",
+        "GlobalSettings[*].FACTORY_WRAPPER.DATA.PURCHASE_SETTINGS_DEF_CLASS.TYPE",
+        });
+    QVector<MasterSectionRef> out;
+    const bool ok = projection.scanFile(masterPath, [&out](int path, int record, const JsonProjection::Value& v) {
+        if (record >= out.size()) out.resize(record + 1);
+        MasterSectionRef& r = out[record];
+        switch (path) {
+        case 0: r.id = v.toInt64(); break;
+        case 1: r.name = v.toString(); break;
+        case 2: r.team = v.toInt(); break;
+        case 3: r.type = v.toInt(); break;
+        }
+        });
+    if (!ok) out.clear();   // as before: a master that does not parse yields nothing
+    return out;
+}
+
+// Build (TEAM,TYPE) -> {PARENT_ID, DEF_NAME} from master file
+static QMap<QPair<int, int>, ParentRef>
+buildParentRefMapFromMaster(const QString& masterPath, std::function<bool(const QString&)> nameFilter = {})
+{
+    QMap<QPair<int, int>, ParentRef> out;
+
+    for (const MasterSectionRef& r : readMasterSectionRefs(masterPath)) {
+        // Optional: only take certain named lists, e.g. skip "(Neutral)" if desired
+        if (nameFilter && !nameFilter(r.name)) continue;
+
+        const QPair<int, int> key(r.team, r.type);
+        if (!out.contains(key)) {
+            out.insert(key, ParentRef{ r.id, r.name });
+        }
+        // If multiple candidates per (TEAM,TYPE) exist, first one wins.
+    }
+    return out;
+}
+
+static inline QString teamWord(int team) {
+    return (team == 0 ? QStringLiteral("Allied") : QStringLiteral("Soviet"));
+}
+
+static inline QString typeWord(int type) {
+    switch (type) {
+    case 0: return QStringLiteral("Infantry");
+    case 1: return QStringLiteral("Vehicles");
+    case 4: return QStringLiteral("Extra Vehicles");
+    case 5: return QStringLiteral("Air");
+    case 7: return QStringLiteral("Extra Air");
+    case 6: return QStringLiteral("Navy");
+    default: return QStringLiteral("Type %1").arg(type);
+    }
+}
+
+// Helper for (TEAM,TYPE) key
+struct TeamType {
+    int team;
+    int type;
+    bool operator==(const TeamType& o) const { return team == o.team && type == o.type; }
+};
+inline uint qHash(const TeamType& k, uint seed = 0) {
+    return qHash((quint64(uint16_t(k.team) << 16) | uint16_t(k.type)), seed);
+}
+
+static inline QString normalizeTheme(QString t) {
+    t = t.trimmed().toLower();
+    if (t.startsWith('d') || t.contains("desert")) return "desert";
+    if (t.startsWith('u') || t.contains("urban"))  return "urban";
+    if (t.startsWith('s') || t.contains("snow"))   return "snow";
+    return "forest";
+}
+
+static bool parseListId(const QString& listId, int& team, int& type, QString* nameOut = nullptr) {
+    // Format: TEAM=%1|TYPE=%2|NAME=%3
+    const auto parts = listId.split('|');
+    if (parts.size() != 3) return false;
+    bool ok1 = false, ok2 = false;
+    team = parts[0].mid(QString("TEAM=").size()).toInt(&ok1);
+    type = parts[1].mid(QString("TYPE=").size()).toInt(&ok2);
+    if (!ok1 || !ok2) return false;
+    if (nameOut) *nameOut = parts[2].mid(QString("NAME=").size());
+    return true;
+}
+
+
+// Per-section refs (DEF_ID, DEF_NAME, TEAM, TYPE) of a level Definitions
+// document, read off the tree that was just edited rather than re-parsed.
+using LevelDefRefs = QVector<std::tuple<int, QString, int, int>>;
+
+static LevelDefRefs collectLevelDefs(const JsonCst& doc) {
+    LevelDefRefs out;
+    const JsonCst::Node gs = doc.member(doc.root(), "GlobalSettings");
+    for (JsonCst::Node e = doc.firstChild(gs); e >= 0; e = doc.nextSibling(e)) {
+        const JsonCst::Node data = doc.path(e, { "FACTORY_WRAPPER", "DATA" });
+        const JsonCst::Node base = doc.member(data, "DEFINITION_BASE");
+        const JsonCst::Node ps = doc.member(data, "PURCHASE_SETTINGS_DEF_CLASS");
+
+        const int defId = doc.toInt(doc.member(base, "ID"));
+        const QString name = doc.toString(doc.member(base, "NAME"));
+        const int team = doc.toInt(doc.member(ps, "TEAM"));
+        const int type = doc.toInt(doc.member(ps, "TYPE"));
+
+        if (defId != 0)
+            out.push_back({ defId, name, team, type });
+    }
+    return out;
+}
+
+static QString levelPresetsPath(const QString& levelEditRootPath, const QString& level) {
+    return QStringLiteral("%1/Database/Levels/%2/Presets/GlobalSettings.json")
+        .arg(levelEditRootPath, level);
+}
+
+// Convert {team,type} -> parentId map into the per-level Presets/GlobalSettings.json
+static QByteArray buildLevelPresetsGlobalSettings(
+    const LevelDefRefs& defs,                 // sections of the level's *Definitions*
+    const QHash<TeamType, int>& parentByTT)
+{
+    // Stream it out; SCHEMA_VERSION and VERSION stay at the top
+    QByteArray out;
+    QBuffer buf(&out);
+    buf.open(QIODevice::WriteOnly);
+    JsonStreamWriter w(&buf);
+    w.beginObject();
+    w.value("SCHEMA_VERSION", 1);
+    w.value("VERSION", 13361);
+    w.beginArray("GlobalSettings");
+    for (const auto& tup : defs) {
+        const int defId = std::get<0>(tup);
+        const QString defName = std::get<1>(tup);   // whatever you set in Definitions/DEFINITION_BASE.NAME
+        const int team = std::get<2>(tup);
+        const int type = std::get<3>(tup);
+
+        w.beginObject();
+        w.value("DEF_ID", defId);
+        w.value("DEF_NAME", defName.trimmed().isEmpty() ? QString() : defName);
+        w.value("IS_TEMP", true);
+        w.value("PARENT_ID", parentByTT.value(TeamType{ team, type }, 0));
+        w.endObject();
+    }
+    w.endArray();
+    w.endObject();
+    w.flush();
+    return out;
+}
+// --- adapter: turn QMap<QPair<int,int>, ParentRef> into QHash<TeamType, int> ---
+static QHash<TeamType, int>
+flattenParentMap(const QMap<QPair<int, int>, ParentRef>& src)
+{
+    QHash<TeamType, int> out;
+    out.reserve(src.size());
+    for (auto it = src.cbegin(); it != src.cend(); ++it) {
+        const int team = it.key().first;
+        const int type = it.key().second;
+        // NOTE: if your ParentRef uses a different member name than 'parentId',
+        // change the line below accordingly (e.g., it.value().id).
+        out.insert(TeamType{ team, type }, it.value().parentId);
+    }
+    return out;
+}
+
+// ===== GlobalSettings documents =====
+// The read-modify-write paths load each GlobalSettings.json into a JsonCst
+// once, change values in place and serialize it back, so every line nobody
+// touched keeps its exact formatting.
+
+static inline bool isJsonSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool loadGlobalSettingsDoc(const QString& path, JsonCst& doc) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    QString err;
+    if (!doc.parse(f.readAll(), &err)) {
+        qWarning() << "Cannot parse" << path << err;
+        return false;
+    }
+    return true;
+}
+
+// PURCHASE_SETTINGS_DEF_CLASS objects under GlobalSettings, in file order.
+static QVector<JsonCst::Node> purchaseSections(const JsonCst& doc) {
+    QVector<JsonCst::Node> out;
+    const JsonCst::Node gs = doc.member(doc.root(), "GlobalSettings");
+    for (JsonCst::Node e = doc.firstChild(gs); e >= 0; e = doc.nextSibling(e)) {
+        const JsonCst::Node ps = doc.path(e, { "FACTORY_WRAPPER", "DATA", "PURCHASE_SETTINGS_DEF_CLASS" });
+        if (ps >= 0 && doc.kind(ps) == JsonCst::Object) out.push_back(ps);
+    }
+    return out;
+}
+
+// The same sections grouped by (TEAM,TYPE), file order kept within a group.
+using SectionIndex = QHash<TeamType, QVector<JsonCst::Node>>;
+
+static SectionIndex indexPurchaseSections(const JsonCst& doc) {
+    SectionIndex out;
+    for (JsonCst::Node ps : purchaseSections(doc)) {
+        const JsonCst::Node team = doc.member(ps, "TEAM");
+        const JsonCst::Node type = doc.member(ps, "TYPE");
+        if (team < 0 || type < 0) continue;
+        out[TeamType{ doc.toInt(team), doc.toInt(type) }].push_back(ps);
+    }
+    return out;
+}
+
+struct PatchOptions {
+    bool coreFields = true;   // cost/tech/limits/factory flags
+    bool textures = false;  // base TEXTURE
+    bool altArrays = false;  // ALT_PRESETIDS / ALT_TEXTURES
+};
+
+static inline QString canonEmpty(const QString& s) {
+    return s.trimmed().isEmpty() ? QString() : s;
+}
+
+static QByteArray jsonQuote(const QString& s) {
+    QString out = canonEmpty(s);     // <- normalize here
+    out.replace("\\", "\\\\");
+    out.replace("\"", "\\\"");
+    return '"' + out.toUtf8() + '"';
+}
+
+// Indents of a multi-line array value: the first element's ("[\n<elem>x")
+// and the closing bracket's ("\n<end>]"). Empty when not found.
+static void multilineArrayIndents(const QByteArray& val, QByteArray& elemIndent, QByteArray& endIndent) {
+    elemIndent.clear();
+    endIndent.clear();
+
+    int i = val.indexOf('[') + 1, lastNl = -1;
+    while (i > 0 && i < val.size() && isJsonSpace(val.at(i))) {
+        if (val.at(i) == '\n') lastNl = i;
+        ++i;
+    }
+    if (lastNl >= 0) {
+        int j = lastNl + 1;
+        while (j < i && (val.at(j) == ' ' || val.at(j) == '\t')) ++j;
+        elemIndent = val.mid(lastNl + 1, j - lastNl - 1);
+    }
+
+    const int close = val.lastIndexOf(']');
+    int k = close;
+    while (k > 0 && (val.at(k - 1) == ' ' || val.at(k - 1) == '\t')) --k;
+    if (close >= 0 && k > 0 && val.at(k - 1) == '\n')
+        endIndent = val.mid(k, close - k);
+}
+
+// New literal for an int array value, keeping its single/multi-line layout.
+static QByteArray arrayIntsPreserving(const QByteArray& val, const QVector<int>& xs) {
+    const QByteArray trimmed = val.trimmed();
+
+    auto oneline = [&](int a, int b, int c) {
+        return "[" + QByteArray::number(a) + ", " + QByteArray::number(b) + ", " + QByteArray::number(c) + "]";
+        };
+
+    if (!trimmed.startsWith('[') || !trimmed.endsWith(']'))
+        return oneline(xs.value(0, 0), xs.value(1, 0), xs.value(2, 0));
+
+    if (val.contains('\n')) {
+        QByteArray elemIndent, endIndent;
+        multilineArrayIndents(val, elemIndent, endIndent);
+
+        return
+            "[\n" + elemIndent + QByteArray::number(xs.value(0, 0)) + ",\n" +
+            elemIndent + QByteArray::number(xs.value(1, 0)) + ",\n" +
+            elemIndent + QByteArray::number(xs.value(2, 0)) + "\n" +
+            endIndent + "]";
+    }
+
+    return oneline(xs.value(0, 0), xs.value(1, 0), xs.value(2, 0));
+}
+
+// New literal for a string array value, keeping its single/multi-line layout.
+static QByteArray arrayStringsPreserving(const QByteArray& val, const QVector<QString>& xsIn) {
+    QVector<QString> xs = xsIn;
+    for (QString& v : xs) v = canonEmpty(v);
+
+    const QByteArray trimmed = val.trimmed();
+
+    auto q = [](const QString& s) { return jsonQuote(canonEmpty(s)); };
+    auto oneline = [&](const QString& a, const QString& b, const QString& c) {
+        return "[" + q(a) + ", " + q(b) + ", " + q(c) + "]";
+        };
+
+    if (!trimmed.startsWith('[') || !trimmed.endsWith(']'))
+        return oneline(xs.value(0), xs.value(1), xs.value(2));
+
+    if (val.contains('\n')) {
+        QByteArray elemIndent, endIndent;
+        multilineArrayIndents(val, elemIndent, endIndent);
+
+        return
+            "[\n" + elemIndent + q(xs.value(0)) + ",\n" +
+            elemIndent + q(xs.value(1)) + ",\n" +
+            elemIndent + q(xs.value(2)) + "\n" +
+            endIndent + "]";
+    }
+
+    return oneline(xs.value(0), xs.value(1), xs.value(2));
+}
+
+// The element of a section's PURCHASE_ITEMS with this PRESET_ID, or -1.
+static JsonCst::Node findItemNode(const JsonCst& doc, JsonCst::Node section, int presetId) {
+    const JsonCst::Node items = doc.member(section, "PURCHASE_ITEMS");
+    for (JsonCst::Node e = doc.firstChild(items); e >= 0; e = doc.nextSibling(e)) {
+        const JsonCst::Node id = doc.member(e, "PRESET_ID");
+        if (id >= 0 && doc.kind(id) == JsonCst::Number && doc.toInt(id) == presetId) return e;
+    }
+    return -1;
+}
+
+// ALT_PRESETIDS: a 3-slot array is updated slot by slot so its layout stays
+// as it is; any other shape is rebuilt. True if anything changed.
+static bool patchAltPresetIds(JsonCst& doc, JsonCst::Node arr, const QVector<int>& xs) {
+    if (arr < 0) return false;
+    if (doc.kind(arr) == JsonCst::Array && doc.childCount(arr) >= 3) {
+        bool same = true;
+        JsonCst::Node e = doc.firstChild(arr);
+        for (int i = 0; i < 3; ++i, e = doc.nextSibling(e))
+            same = same && doc.kind(e) == JsonCst::Number && doc.toInt(e) == xs.value(i, 0);
+        if (same) return false;
+    }
+    if (doc.kind(arr) == JsonCst::Array && doc.childCount(arr) == 3) {
+        JsonCst::Node e = doc.firstChild(arr);
+        for (int i = 0; i < 3; ++i, e = doc.nextSibling(e))
+            doc.replace(e, QByteArray::number(xs.value(i, 0)));
+        return true;
+    }
+    return doc.replace(arr, arrayIntsPreserving(doc.text(arr), xs));
+}
+
+// ALT_TEXTURES, same rules as ALT_PRESETIDS.
+static bool patchAltTextures(JsonCst& doc, JsonCst::Node arr, const QVector<QString>& xs) {
+    if (arr < 0) return false;
+    if (doc.kind(arr) == JsonCst::Array && doc.childCount(arr) >= 3) {
+        bool same = true;
+        JsonCst::Node e = doc.firstChild(arr);
+        for (int i = 0; i < 3; ++i, e = doc.nextSibling(e))
+            same = same && doc.toString(e) == canonEmpty(xs.value(i));
+        if (same) return false;
+    }
+    if (doc.kind(arr) == JsonCst::Array && doc.childCount(arr) == 3) {
+        JsonCst::Node e = doc.firstChild(arr);
+        for (int i = 0; i < 3; ++i, e = doc.nextSibling(e))
+            doc.replace(e, jsonQuote(xs.value(i)));
+        return true;
+    }
+    return doc.replace(arr, arrayStringsPreserving(doc.text(arr), xs));
+}
+
+// Bring one purchase item in line with `src`. Only values that differ are
+// rewritten; returns true if anything changed.
+static bool patchItemNode(JsonCst& doc, JsonCst::Node item, const PurchaseItem& src, const PatchOptions& opt) {
+    bool changed = false;
+    auto setInt = [&](const char* key, int v) {
+        const JsonCst::Node n = doc.member(item, key);
+        if (n < 0 || (doc.kind(n) == JsonCst::Number && doc.toInt(n) == v)) return;
+        changed = doc.replace(n, QByteArray::number(v)) || changed;
+        };
+    auto setBool = [&](const char* key, bool v) {
+        const JsonCst::Node n = doc.member(item, key);
+        if (n < 0 || (doc.kind(n) == JsonCst::Bool && doc.toBool(n) == v)) return;
+        changed = doc.replace(n, v ? "true" : "false") || changed;
+        };
+    auto setStr = [&](const char* key, const QString& v) {
+        const JsonCst::Node n = doc.member(item, key);
+        if (n < 0 || (doc.kind(n) == JsonCst::String && doc.toString(n).trimmed() == canonEmpty(v))) return;
+        changed = doc.replace(n, jsonQuote(v)) || changed;
+        };
+
+    if (opt.coreFields) {
+        setInt("COST", src.cost);
+        setInt("TECH_LEVEL", src.techLevel);
+        setInt("SPECIAL_TECH_NUMBER", src.specialTechNumber);
+        setInt("UNIT_LIMIT", src.unitLimit);
+        setInt("FACTORY", src.factory);
+        setInt("TECH_BUILDING", src.techBuilding);
+        setBool("FACTORY_NOT_REQUIRED", src.factoryNotRequired);
+    }
+    if (opt.textures) setStr("TEXTURE", src.texture);
+    if (opt.altArrays) {
+        changed = patchAltPresetIds(doc, doc.member(item, "ALT_PRESETIDS"), src.altPresetIds) || changed;
+        changed = patchAltTextures(doc, doc.member(item, "ALT_TEXTURES"), src.altTextures) || changed;
+    }
+    return changed;
+}
+
+// Patch presetId in the first of `sections` that holds it, or in all of them
+// with everyOccurrence. Returns the number of items that changed.
+static int patchPurchaseItem(JsonCst& doc, const QVector<JsonCst::Node>& sections, int presetId,
+    const PurchaseItem& src, const PatchOptions& opt,
+    bool everyOccurrence = false, bool* outFound = nullptr)
+{
+    if (outFound) *outFound = false;
+    int patched = 0;
+    for (JsonCst::Node ps : sections) {
+        const JsonCst::Node item = findItemNode(doc, ps, presetId);
+        if (item < 0) continue;
+        if (outFound) *outFound = true;
+        if (patchItemNode(doc, item, src, opt)) ++patched;
+        if (!everyOccurrence) break;
+    }
+    return patched;
+}
+
+// Build a canonical key for a unit group: sorted unique of base + alt preset IDs
+static QString canonicalPresetKey(const PurchaseItem& it) {
+    QVector<int> ids;
+    ids.reserve(1 + it.altPresetIds.size());
+    ids.push_back(it.presetId);
+    for (int id : it.altPresetIds) if (id != 0) ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    QString key; key.reserve(ids.size() * 12);
+    for (int id : ids) { key += QString::number(id); key += '_'; }
+    return key;
+}
+
+static QString canonicalPresetKey(const JsonCst& doc, JsonCst::Node item) {
+    QVector<int> ids;
+    ids.reserve(4);
+    ids.push_back(doc.toInt(doc.member(item, "PRESET_ID")));
+    const JsonCst::Node alts = doc.member(item, "ALT_PRESETIDS");
+    for (JsonCst::Node a = doc.firstChild(alts); a >= 0; a = doc.nextSibling(a))
+        if (int id = doc.toInt(a); id != 0) ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    QString key; key.reserve(ids.size() * 12);
+    for (int id : ids) { key += QString::number(id); key += '_'; }
+    return key;
+}
+
+// Every purchase item of a document, found in one walk, with lookups by
+// PRESET_ID and by canonical key. Patching through it touches only the
+// occurrences that match instead of rescanning sections per edit.
+struct PresetOccurrence {
+    JsonCst::Node section = -1;
+    JsonCst::Node item = -1;
+    TeamType teamType{};
+};
+
+struct PresetIndex {
+    QVector<PresetOccurrence> items;            // file order
+    QHash<int, QVector<int>> byPresetId;        // -> positions in items
+    QHash<QString, QVector<int>> byKey;         // canonicalPresetKey -> positions in items
+};
+
+static PresetIndex indexPresets(const JsonCst& doc) {
+    PresetIndex out;
+    for (JsonCst::Node ps : purchaseSections(doc)) {
+        const TeamType tt{ doc.toInt(doc.member(ps, "TEAM"), -1), doc.toInt(doc.member(ps, "TYPE"), -1) };
+        const JsonCst::Node items = doc.member(ps, "PURCHASE_ITEMS");
+        for (JsonCst::Node e = doc.firstChild(items); e >= 0; e = doc.nextSibling(e)) {
+            const JsonCst::Node id = doc.member(e, "PRESET_ID");
+            if (id < 0 || doc.kind(id) != JsonCst::Number) continue;
+            const int at = out.items.size();
+            out.items.push_back(PresetOccurrence{ ps, e, tt });
+            out.byPresetId[doc.toInt(id)].push_back(at);
+            out.byKey[canonicalPresetKey(doc, e)].push_back(at);
+        }
+    }
+    return out;
+}
+
+// Merge b into a (union textures/alts; min cost/tech as a sane default)
+static void mergePurchaseItem(PurchaseItem& a, const PurchaseItem& b) {
+    // cost/tech: keep the lowest tech and lowest cost (tweak if you want different policy)
+    a.techLevel = std::min(a.techLevel, b.techLevel);
+    a.cost = std::min(a.cost, b.cost);
+
+    // texture pool: a.base + a.alts + b.base + b.alts -> unique, non-empty
+    QStringList pool;
+    auto addTex = [&](const QString& t) { const QString n = t.trimmed(); if (!n.isEmpty()) pool << n; };
+    addTex(a.texture);
+    for (const auto& t : a.altTextures) addTex(t);
+    addTex(b.texture);
+    for (const auto& t : b.altTextures) addTex(t);
+
+    QSet<QString> seen;
+    QStringList uniq;
+    for (const auto& t : pool) if (!seen.contains(t)) { seen.insert(t); uniq << t; }
+
+    // choose first as base, next up to 3 as alts
+    if (!uniq.isEmpty()) {
+        a.texture = uniq.front();
+        uniq.pop_front();
+    }
+    a.altTextures = QVector<QString>::fromList(uniq.mid(0, 3));
+    while (a.altTextures.size() < 3) a.altTextures << "";
+
+    // alt preset IDs: union of both (non-zero), but keep only up to 3 in the JSON slots
+    QVector<int> ids;
+    ids << a.presetId;
+    for (int id : a.altPresetIds) if (id) ids << id;
+    ids << b.presetId;
+    for (int id : b.altPresetIds) if (id) ids << id;
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::remove(ids.begin(), ids.end(), 0), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    // keep a.presetId as-is; fill the rest from union (excluding base)
+    QVector<int> rest = ids;
+    rest.erase(std::remove(rest.begin(), rest.end(), a.presetId), rest.end());
+    a.altPresetIds = rest.mid(0, 3);
+    while (a.altPresetIds.size() < 3) a.altPresetIds << 0;
+}
+
+// Dedupe items in a tab (label) by canonical preset set
+static void dedupeWithinLabel(QVector<PurchaseItem>& list) {
+    QMap<QString, PurchaseItem> byKey;
+    for (const PurchaseItem& it : list) {
+        if (it.presetId == 0) continue; // skip placeholders
+        const QString key = canonicalPresetKey(it);
+        auto found = byKey.find(key);
+        if (found == byKey.end()) {
+            PurchaseItem base = it;
+            // normalize textures of the first item
+           // mergePurchaseItem(base, PurchaseItem{});
+            byKey.insert(key, base);
+        }
+        else {
+            PurchaseItem merged = found.value();
+            mergePurchaseItem(merged, it);
+            found.value() = merged;
+        }
+    }
+
+    list = byKey.values().toVector();
+
+    // Optional: stable sort (e.g., by tech then cost then preset)
+    std::stable_sort(list.begin(), list.end(), [](const PurchaseItem& a, const PurchaseItem& b) {
+        if (a.techLevel != b.techLevel) return a.techLevel < b.techLevel;
+        if (a.cost != b.cost)      return a.cost < b.cost;
+        return a.presetId < b.presetId;
+        });
+}
+
+// --- CAMO reorder helpers (operate on parsed JSON items) ---------------------
+
+static inline QString trimOrEmpty(const QString& s) { return s.trimmed(); }
+
+// Camo letter from the last six characters of a texture name: 'f','d','u'
+// or 's' for "_f.dds" .. "_s.dds" in any case, 0 otherwise.
+static char camoCodeOfTail(const char* t) {
+    if (t[0] != '_' || t[2] != '.') return 0;
+    if ((t[3] | 0x20) != 'd' || (t[4] | 0x20) != 'd' || (t[5] | 0x20) != 's') return 0;
+    const char c = char(t[1] | 0x20);
+    return (c == 'f' || c == 'd' || c == 'u' || c == 's') ? c : 0;
+}
+
+// returns one of 'f','d','u','s', or 0 if no known suffix
+static QChar camoCodeForTex(const QString& tex) {
+    const QString t = tex.trimmed();
+    if (t.size() < 6) return QChar{};
+    char tail[6];
+    for (int i = 0; i < 6; ++i) {
+        const ushort u = t.at(t.size() - 6 + i).unicode();
+        if (u > 0x7f) return QChar{};
+        tail[i] = char(u);
+    }
+    const char code = camoCodeOfTail(tail);
+    return code ? QChar(code) : QChar{};
+}
+
+// Same, read off a JSON string literal as written (quotes included), so no
+// decoding is needed to classify a texture.
+static char camoCodeOfLiteral(const QByteArray& lit) {
+    int end = lit.size() - 1;   // closing quote
+    if (end < 1 || lit.at(end) != '"') return 0;
+    while (end > 1 && isJsonSpace(lit.at(end - 1))) --end;
+    if (end - 1 < 6) return 0;
+    return camoCodeOfTail(lit.constData() + end - 6);
+}
+
+// Whether any "_<code>.dds" (any case) appears in the text.
+static bool mentionsCamo(const QByteArray& text, char code) {
+    for (int i = text.indexOf('_'); i >= 0 && i + 6 <= text.size(); i = text.indexOf('_', i + 1)) {
+        if (camoCodeOfTail(text.constData() + i) == code) return true;
+    }
+    return false;
+}
+
+static QChar themeToCode(const QString& theme) {
+    const QString t = theme.trimmed().toLower();
+    if (t.startsWith('d')) return QChar('d'); // desert
+    if (t.startsWith('u')) return QChar('u'); // urban
+    if (t.startsWith('s')) return QChar('s'); // snow
+    return QChar('f');                        // default forest
+}
+
+// One item's textures for a theme: blanks dropped, the theme's camo first,
+// everything else in its original order. Alt preset IDs stay as they are.
+static void orderTexturesForTheme(PurchaseItem& item, QChar want) {
+    QStringList all = { item.texture };
+    all.append(item.altTextures);
+    all.erase(std::remove_if(all.begin(), all.end(), [](const QString& s) { return s.trimmed().isEmpty(); }), all.end());
+
+    // Classify each texture once, not per comparison
+    QVector<int> idx(all.size());
+    std::iota(idx.begin(), idx.end(), 0);
+    QVector<bool> hit(all.size());
+    for (int i = 0; i < all.size(); ++i) hit[i] = (camoCodeForTex(all.at(i)) == want);
+    std::stable_partition(idx.begin(), idx.end(), [&](int i) { return hit.at(i); });
+
+    QStringList sorted;
+    for (int i : idx) sorted << all.at(i);
+    item.texture = sorted.value(0);
+    item.altTextures = sorted.mid(1, 3);
+    while (item.altTextures.size() < 3)
+        item.altTextures.append("");
+}
+
+TabLists SidebarEngine::listsForTheme(TabLists lists, const QString& theme) {
+    const QChar want = themeToCode(theme);
+    for (auto& list : lists)
+        for (PurchaseItem& item : list) orderTexturesForTheme(item, want);
+    return lists;
+}
+
+// One purchase item, in LevelEdit member order with 3-slot ALT arrays.
+static void writePurchaseItem(JsonStreamWriter& w, const PurchaseItem& item) {
+    w.beginObject();
+    w.value("COST", item.cost);
+    w.value("PRESET_ID", item.presetId);
+    w.value("STRING_ID", item.stringId);
+    w.value("TEXTURE", item.texture);
+    w.value("TECH_LEVEL", item.techLevel);
+    w.value("SPECIAL_TECH_NUMBER", item.specialTechNumber);
+    w.value("UNIT_LIMIT", item.unitLimit);
+    w.value("FACTORY", item.factory);
+    w.value("TECH_BUILDING", item.techBuilding);
+    w.value("FACTORY_NOT_REQUIRED", item.factoryNotRequired);
+    w.intArray3("ALT_PRESETIDS", item.altPresetIds);
+    w.stringArray3("ALT_TEXTURES", item.altTextures);
+    w.endObject();
+}
+
+// A standalone GlobalSettings document holding the given lists, one
+// section per list with generated IDs.
+void SidebarEngine::writeExportJson(JsonStreamWriter& w, const TabLists& lists) {
+    const int factoryId = 263687;
+    const int baseId = 1000000000;
+    int defCounter = 0;
+
+    w.beginObject();
+    w.beginArray("GlobalSettings");
+    for (auto it = lists.begin(); it != lists.end(); ++it, ++defCounter) {
+        w.beginObject();
+        w.value("FACTORY_ID", factoryId);
+        w.beginObject("FACTORY_WRAPPER");
+        w.beginObject("DATA");
+        w.beginObject("DEFINITION_BASE");
+        w.value("ID", baseId + defCounter);
+        w.value("NAME", QString::number(defCounter + 1));
+        w.endObject();
+        w.beginObject("PURCHASE_SETTINGS_DEF_CLASS");
+        w.value("TEAM", it.value().value(0).team);
+        w.value("TYPE", it.value().value(0).type);
+        w.beginArray("PURCHASE_ITEMS");
+        for (const PurchaseItem& item : it.value()) writePurchaseItem(w, item);
+        w.endArray();
+        w.endObject();
+        w.endObject();
+        w.endObject();
+        w.endObject();
+    }
+    w.endArray();
+    w.endObject();
+}
+
+static QByteArray buildExportJson(const QMap<QString, QVector<PurchaseItem>>& lists) {
+    QByteArray out;
+    QBuffer buf(&out);
+    buf.open(QIODevice::WriteOnly);
+    {
+        JsonStreamWriter w(&buf);
+        SidebarEngine::writeExportJson(w, lists);
+    }
+    return out;
+}
+
+// Per-theme results for a batch over many maps. There are only four
+// themes, so each plan (reordered lists, exported bytes, parent IDs) is
+// built the first time a theme comes up and reused for every later map.
+class ThemePlanCache {
+public:
+    using ParentResolver = std::function<QHash<TeamType, int>(const QString& theme)>;
+
+    explicit ThemePlanCache(const QMap<QString, QVector<PurchaseItem>>& lists, ParentResolver parents = {})
+        : m_lists(lists), m_parents(std::move(parents)) {}
+
+    const QMap<QString, QVector<PurchaseItem>>& lists(const QString& theme) {
+        Plan& p = plan(theme);
+        if (!p.hasLists) {
+            p.lists = SidebarEngine::listsForTheme(m_lists, p.theme);
+            p.hasLists = true;
+        }
+        return p.lists;
+    }
+    const QByteArray& exportJson(const QString& theme) {
+        Plan& p = plan(theme);
+        if (p.exportJson.isEmpty()) p.exportJson = buildExportJson(lists(theme));
+        return p.exportJson;
+    }
+    const QHash<TeamType, int>& parentByTT(const QString& theme) {
+        Plan& p = plan(theme);
+        if (!p.hasParents) {
+            if (m_parents) p.parentByTT = m_parents(p.theme);
+            p.hasParents = true;
+        }
+        return p.parentByTT;
+    }
+
+private:
+    struct Plan {
+        QString theme;
+        bool hasLists = false;
+        bool hasParents = false;
+        QMap<QString, QVector<PurchaseItem>> lists;
+        QByteArray exportJson;
+        QHash<TeamType, int> parentByTT;
+    };
+    Plan& plan(const QString& theme) {
+        const QString key = normalizeTheme(theme);
+        Plan& p = m_plans[key];
+        p.theme = key;
+        return p;
+    }
+
+    QMap<QString, QVector<PurchaseItem>> m_lists;
+    ParentResolver m_parents;
+    QHash<QString, Plan> m_plans;
+};
+
+// Scan ALL existing DEF_IDs so we avoid duplicates across this run.
+static QSet<int> collectAllExistingDefIds(const QString& root) {
+    QSet<int> ids;
+    QMutex idsMutex;
+
+    // Only the IDs are read; the rest of each file is skipped unparsed.
+    // IDs before a syntax error still count: they are taken either way.
+    // Files are scanned in parallel as the walker finds them; each keeps
+    // its own IDs and hands them over once.
+    static const JsonProjection projection({ "GlobalSettings[*].FACTORY_WRAPPER.DATA.DEFINITION_BASE.ID" });
+    DatabaseWalker(root).forEachFile(
+        DatabaseWalker::GlobalDefinitions | DatabaseWalker::GlobalPresets | DatabaseWalker::LevelDefinitions,
+        [&](const QString& path) {
+            QVector<int> found;
+            projection.scanFile(path, [&found](int, int, const JsonProjection::Value& v) {
+                if (const int id = v.toInt()) found.push_back(id);
+                });
+            if (found.isEmpty()) return;
+            QMutexLocker lock(&idsMutex);
+            for (int id : found) ids.insert(id);
+        });
+    return ids;
+}
+
+// Simple allocator that hands out never-before-seen IDs in this run.
+struct DefIdAllocator {
+    QSet<int> used;
+    int next;
+
+    explicit DefIdAllocator(const QSet<int>& already) : used(already) {
+        int maxId = 1000000000;
+        for (int id : used) maxId = std::max(maxId, id);
+        next = std::max(1000000000, maxId + 1);
+        while (used.contains(next)) ++next;
+    }
+    int take() {
+        int id = next;
+        used.insert(id);
+        do { ++next; } while (used.contains(next));
+        return id;
+    }
+};
+
+// Append an empty purchase section to GlobalSettings:[...], indented like the
+// existing blocks. Returns its PURCHASE_SETTINGS_DEF_CLASS node, or -1.
+static JsonCst::Node appendSectionBlock(JsonCst& doc, int defId, const QString& name, int team, int type) {
+    const JsonCst::Node gs = doc.member(doc.root(), "GlobalSettings");
+    if (gs < 0 || doc.kind(gs) != JsonCst::Array) return -1;
+
+    const QByteArray block = buildSectionBlockText(defId, name, team, type, doc.elementIndent(gs));
+    const JsonCst::Node e = doc.appendElement(gs, block);
+    return doc.path(e, { "FACTORY_WRAPPER", "DATA", "PURCHASE_SETTINGS_DEF_CLASS" });
+}
+
+// ===== SidebarEngine =====
+
+// Edited items by canonical key; the last tab wins for a unit in several.
+static QHash<QString, PurchaseItem> editsByKey(const TabLists& tabs) {
+    QHash<QString, PurchaseItem> map;
+    for (auto it = tabs.cbegin(); it != tabs.cend(); ++it) {
+        for (const PurchaseItem& item : it.value()) {
+            const QString key = canonicalPresetKey(item);
+            map.insert(key, item);
+        }
+    }
+    return map;
+}
+
+// Identity of a master section's source bytes. Only compared within one
+// session, to tell "as loaded" from "changed since".
+static QByteArray sourceHash(const QByteArray& text) {
+    return QCryptographicHash::hash(text, QCryptographicHash::Sha1);
+}
+
+// GlobalSettings elements keyed like the purchase lists (TEAM/TYPE/NAME);
+// a key seen again in the same file gets "#2", "#3", ...
+static QVector<QPair<JsonCst::Node, QString>> keyedSections(const JsonCst& doc) {
+    QVector<QPair<JsonCst::Node, QString>> out;
+    QHash<QString, int> seen;
+    const JsonCst::Node gs = doc.member(doc.root(), "GlobalSettings");
+    for (JsonCst::Node e = doc.firstChild(gs); e >= 0; e = doc.nextSibling(e)) {
+        const JsonCst::Node data = doc.path(e, { "FACTORY_WRAPPER", "DATA" });
+        const JsonCst::Node ps = doc.member(data, "PURCHASE_SETTINGS_DEF_CLASS");
+        QString key = QString("TEAM=%1|TYPE=%2|NAME=%3")
+            .arg(doc.toInt(doc.member(ps, "TEAM"))).arg(doc.toInt(doc.member(ps, "TYPE")))
+            .arg(doc.toString(doc.path(data, { "DEFINITION_BASE", "NAME" })));
+        if (const int n = ++seen[key]; n > 1) key += QString("#%1").arg(n);
+        out.push_back({ e, key });
+    }
+    return out;
+}
+
+// Source hash of each purchase item of a section, by PRESET_ID.
+static QHash<int, QByteArray> itemHashes(const JsonCst& doc, JsonCst::Node section) {
+    QHash<int, QByteArray> out;
+    const JsonCst::Node items = doc.path(section, { "FACTORY_WRAPPER", "DATA", "PURCHASE_SETTINGS_DEF_CLASS", "PURCHASE_ITEMS" });
+    for (JsonCst::Node e = doc.firstChild(items); e >= 0; e = doc.nextSibling(e)) {
+        const int id = doc.toInt(doc.member(e, "PRESET_ID"), -1);
+        if (id >= 0 && !out.contains(id)) out.insert(id, sourceHash(doc.text(e)));
+    }
+    return out;
+}
+
+// The core fields of a purchase item node, as patchItemNode writes them.
+static PurchaseItem coreFieldsOf(const JsonCst& doc, JsonCst::Node item) {
+    PurchaseItem it;
+    it.presetId = doc.toInt(doc.member(item, "PRESET_ID"));
+    it.cost = doc.toInt(doc.member(item, "COST"));
+    it.techLevel = doc.toInt(doc.member(item, "TECH_LEVEL"));
+    it.specialTechNumber = doc.toInt(doc.member(item, "SPECIAL_TECH_NUMBER"));
+    it.unitLimit = doc.toInt(doc.member(item, "UNIT_LIMIT"));
+    it.factory = doc.toInt(doc.member(item, "FACTORY"));
+    it.techBuilding = doc.toInt(doc.member(item, "TECH_BUILDING"));
+    const JsonCst::Node fnr = doc.member(item, "FACTORY_NOT_REQUIRED");
+    it.factoryNotRequired = fnr >= 0 && doc.kind(fnr) == JsonCst::Bool && doc.toBool(fnr);
+    return it;
+}
+
+static bool sameCoreFields(const PurchaseItem& a, const PurchaseItem& b) {
+    return a.cost == b.cost && a.techLevel == b.techLevel && a.specialTechNumber == b.specialTechNumber
+        && a.unitLimit == b.unitLimit && a.factory == b.factory && a.techBuilding == b.techBuilding
+        && a.factoryNotRequired == b.factoryNotRequired;
+}
+
+// Three-way merge of the core fields into theirs: a field we changed from
+// base takes ours, unless the disk changed it to something else as well;
+// such fields keep the disk's value and are named in the result.
+static QStringList mergeCoreFields(PurchaseItem& theirs, const PurchaseItem& base, const PurchaseItem& ours) {
+    QStringList conflicts;
+    auto field = [&](const char* name, auto PurchaseItem::* f) {
+        if (ours.*f == base.*f || ours.*f == theirs.*f) return;
+        if (theirs.*f == base.*f) theirs.*f = ours.*f;
+        else conflicts << name;
+        };
+    field("COST", &PurchaseItem::cost);
+    field("TECH_LEVEL", &PurchaseItem::techLevel);
+    field("SPECIAL_TECH_NUMBER", &PurchaseItem::specialTechNumber);
+    field("UNIT_LIMIT", &PurchaseItem::unitLimit);
+    field("FACTORY", &PurchaseItem::factory);
+    field("TECH_BUILDING", &PurchaseItem::techBuilding);
+    field("FACTORY_NOT_REQUIRED", &PurchaseItem::factoryNotRequired);
+    return conflicts;
+}
+
+// LevelEdit files are UTF-8, but hand-edited ones sometimes come back Latin-1.
+static bool parseJsonLenient(const QByteArray& raw, QJsonDocument& doc, QString* error) {
+    QJsonParseError err{};
+    doc = QJsonDocument::fromJson(raw, &err);
+    if (err.error == QJsonParseError::NoError) return true;
+
+    err = {};
+    doc = QJsonDocument::fromJson(QString::fromLatin1(raw).toUtf8(), &err);
+    if (err.error == QJsonParseError::NoError) return true;
+    if (error) *error = err.errorString();
+    return false;
+}
+
+static PurchaseItem itemFromJson(const QJsonObject& e, int team, int type) {
+    PurchaseItem it;
+    it.cost = e["COST"].toInt();
+    it.presetId = e["PRESET_ID"].toInt();
+    it.stringId = e["STRING_ID"].toInt();
+    it.texture = e["TEXTURE"].toString().trimmed();
+    it.techLevel = e["TECH_LEVEL"].toInt();
+    it.specialTechNumber = e["SPECIAL_TECH_NUMBER"].toInt();
+    it.unitLimit = e["UNIT_LIMIT"].toInt();
+    it.factory = e["FACTORY"].toInt();
+    it.techBuilding = e["TECH_BUILDING"].toInt();
+    it.factoryNotRequired = e["FACTORY_NOT_REQUIRED"].toBool();
+    it.team = team;
+    it.type = type;
+    for (const auto& ap : e["ALT_PRESETIDS"].toArray()) it.altPresetIds.append(ap.toInt());
+    for (const auto& at : e["ALT_TEXTURES"].toArray())  it.altTextures.append(at.toString());
+    return it;
+}
+
+SidebarEngine::SidebarEngine(const QString& levelEditRoot)
+    : m_root(levelEditRoot) {
+}
+
+QString SidebarEngine::masterPath() const {
+    return m_root + "/Database/Global/Definitions/GlobalSettings.json";
+}
+
+QString SidebarEngine::levelFilePath(const QString& level) const {
+    return LevelPresetIndex::levelFilePath(m_root, level);
+}
+
+QStringList SidebarEngine::levels() const {
+    const QDir baseDir(m_root + "/Database/Levels");
+    return baseDir.entryList(QStringList("RA_*"), QDir::Dirs | QDir::NoDotAndDotDot);
+}
+
+QString SidebarEngine::levelUpdateJournal(const QString& levelEditRoot) {
+    return levelEditRoot + "/level_update_journal.json";
+}
+
+bool SidebarEngine::backUp(const QStringList& paths, const QString& label, QString* error) const {
+    BackupStore store(m_root);
+    store.setCompression(m_compressBackups);
+    return store.snapshot(paths, label, nullptr, error);
+}
+
+bool SidebarEngine::loadMaster(const QString& path, QString* error) {
+    m_lists.clear();
+    m_parentIdByListId.clear();
+    m_nameByListId.clear();
+    m_listBySectionHash.clear();
+    m_sectionHashByListId.clear();
+    m_skippedSections.clear();
+    m_sources.clear();
+    return readMaster(path, nullptr, error);
+}
+
+SidebarEngine::ReloadReport SidebarEngine::reloadMaster(const QString& path) {
+    ReloadReport report;
+    const QHash<QString, QByteArray> before = m_sectionHashByListId;
+    if (!readMaster(path, &report.decoded, &report.error)) return report;
+
+    for (auto it = m_sectionHashByListId.cbegin(); it != m_sectionHashByListId.cend(); ++it) {
+        const auto old = before.constFind(it.key());
+        if (old == before.constEnd()) report.added << it.key();
+        else if (old.value() != it.value()) report.changed << it.key();
+    }
+    for (auto it = before.cbegin(); it != before.cend(); ++it)
+        if (!m_sectionHashByListId.contains(it.key())) report.removed << it.key();
+    report.added.sort();
+    report.changed.sort();
+    report.removed.sort();
+    return report;
+}
+
+// Reads the master's purchase lists. The file is split into its
+// GlobalSettings sections without decoding them; a section whose source
+// text hashes the same as at the last read is reused as decoded then.
+bool SidebarEngine::readMaster(const QString& path, int* decoded, QString* error) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString("cannot open %1").arg(path);
+        return false;
+    }
+    const QByteArray raw = f.readAll();
+    f.close();
+
+    JsonCst cst;
+    QString err;
+    if (!cst.parse(raw, &err)) {
+        if (error) *error = QString("%1: %2").arg(path, err);
+        return false;
+    }
+
+    // What the last read decoded, by section text
+    const QVector<PurchaseList> known = m_lists;
+    const QHash<QByteArray, int> knownByHash = m_listBySectionHash;
+    const QSet<QByteArray> knownSkipped = m_skippedSections;
+    const QHash<QString, int> knownParent = m_parentIdByListId;
+    const QHash<QString, QString> knownName = m_nameByListId;
+    QHash<QByteArray, QHash<int, QByteArray>> knownItems;
+    for (const SectionSource& src : m_sources) knownItems.insert(src.hash, src.items);
+    m_lists.clear();
+    m_parentIdByListId.clear();
+    m_nameByListId.clear();
+    m_listBySectionHash.clear();
+    m_sectionHashByListId.clear();
+    m_skippedSections.clear();
+    m_sources.clear();
+
+    auto keep = [this](const PurchaseList& pl, const QByteArray& hash, SectionSource& src) {
+        src.list = int(m_lists.size());
+        m_listBySectionHash.insert(hash, int(m_lists.size()));
+        m_sectionHashByListId.insert(pl.id, hash);
+        m_lists.append(pl);
+        };
+
+    int fresh = 0;
+    for (const auto& keyed : keyedSections(cst)) {
+        const JsonCst::Node e = keyed.first;
+        const QByteArray text = cst.text(e);
+        const QByteArray hash = sourceHash(text);
+
+        SectionSource& src = m_sources[keyed.second];
+        src.hash = hash;
+        const auto items = knownItems.constFind(hash);
+        src.items = items != knownItems.constEnd() ? items.value() : itemHashes(cst, e);
+
+        if (knownSkipped.contains(hash)) {
+            m_skippedSections.insert(hash);
+            continue;
+        }
+        const auto same = knownByHash.constFind(hash);
+        if (same != knownByHash.constEnd()) {
+            const PurchaseList& pl = known.at(same.value());
+            m_parentIdByListId[pl.id] = knownParent.value(pl.id);
+            m_nameByListId[pl.id] = knownName.value(pl.id);
+            keep(pl, hash, src);
+            continue;
+        }
+
+        ++fresh;
+        QJsonDocument sec;
+        if (!parseJsonLenient(text, sec, &err)) {
+            qWarning() << "Cannot decode a master section in" << path << err;
+            m_skippedSections.insert(hash);
+            continue;
+        }
+        const QJsonObject data = sec.object()["FACTORY_WRAPPER"].toObject()["DATA"].toObject();
+        const QJsonObject def = data["DEFINITION_BASE"].toObject();
+        const QJsonObject ps = data["PURCHASE_SETTINGS_DEF_CLASS"].toObject();
+
+        const QString defName = def["NAME"].toString();
+        int team = ps["TEAM"].toInt();
+        int type = ps["TYPE"].toInt();
+        if (defName.contains("(Neutral)", Qt::CaseInsensitive)   // skip Vehicles (Neutral), etc.
+            || type == 2 || type == 3) {                          // Equipment / Ignore
+            m_skippedSections.insert(hash);
+            continue;
+        }
+
+        PurchaseList pl;
+        pl.name = defName;
+        pl.team = team;
+        pl.type = type;
+        pl.id = QString("TEAM=%1|TYPE=%2|NAME=%3").arg(team).arg(type).arg(defName);
+
+        const auto items = ps["PURCHASE_ITEMS"].toArray();
+        for (const auto& iv : items) {
+            const PurchaseItem it = itemFromJson(iv.toObject(), team, type);
+            if (it.texture.isEmpty()) continue; // drop blanks
+
+            m_parentIdByListId[pl.id] = def["ID"].toInt();   // DEFINITION_BASE.ID of the source list
+            m_nameByListId[pl.id] = defName;              // DEFINITION_BASE.NAME of the source list
+            pl.items.append(it);
+        }
+        if (!pl.items.isEmpty()) keep(pl, hash, src);
+        else m_skippedSections.insert(hash);
+    }
+    if (decoded) *decoded = fresh;
+    return true;
+}
+
+QString SidebarEngine::tabLabel(int type, int team) {
+    QString teamStr = (team == 0 ? "Allied" : "Soviet");
+    switch (type) {
+    case 0: return teamStr + " Infantry";
+    case 1:
+    case 4: return teamStr + " Vehicles";
+    case 5:
+    case 7: return teamStr + " Air";
+    case 6: return teamStr + " Navy";
+    }
+    return "Other";
+}
+
+TabLists SidebarEngine::tabsForSelection(const QSet<QString>& selectedListIds) const {
+    // 1) collect only selected lists
+    TabLists tabs;
+    for (const auto& pl : m_lists) {
+        if (!selectedListIds.contains(pl.id)) continue;
+        tabs[tabLabel(pl.type, pl.team)] += pl.items; // append then dedupe below
+    }
+
+    // 2) dedupe inside each tab (canonical merge rules)
+    for (auto it = tabs.begin(); it != tabs.end(); ++it) {
+        dedupeWithinLabel(it.value());
+    }
+    return tabs;
+}
+
+TabLists SidebarEngine::mergeTabs(const TabLists& base, const TabLists& edited, const TabLists& fresh,
+    MergeReport* report)
+{
+    MergeReport local;
+    MergeReport& r = report ? *report : local;
+
+    QStringList labels = edited.keys();
+    for (const QString& label : fresh.keys())
+        if (!edited.contains(label)) labels << label;
+
+    TabLists out;
+    for (const QString& label : labels) {
+        const QVector<PurchaseItem> baseItems = base.value(label);
+        const QVector<PurchaseItem> editedItems = edited.value(label);
+        const QVector<PurchaseItem> freshItems = fresh.value(label);
+        if (freshItems == baseItems) {
+            // Untouched on disk: the working copy stands as it is (camo order too)
+            if (!editedItems.isEmpty()) out.insert(label, editedItems);
+            continue;
+        }
+        QHash<QString, const PurchaseItem*> baseByKey, editedByKey;
+        for (const PurchaseItem& pi : baseItems) baseByKey.insert(canonicalPresetKey(pi), &pi);
+        for (const PurchaseItem& pi : editedItems) editedByKey.insert(canonicalPresetKey(pi), &pi);
+
+        // Disk order; an item edited here keeps the edit
+        QVector<PurchaseItem> merged;
+        QSet<QString> seen;
+        for (const PurchaseItem& f : freshItems) {
+            const QString key = canonicalPresetKey(f);
+            seen.insert(key);
+            const PurchaseItem* b = baseByKey.value(key);
+            const PurchaseItem* e = editedByKey.value(key);
+            if (!e || (b && *e == *b)) {
+                if (!e || *e != f) ++r.fromDisk;
+                merged << f;
+                continue;
+            }
+            merged << *e;
+            if ((!b || *b != f) && *e != f) r.conflicts << QString("%1: %2").arg(label).arg(f.presetId);
+        }
+
+        // Edited units the master no longer has stay, flagged
+        for (const PurchaseItem& e : editedItems) {
+            const QString key = canonicalPresetKey(e);
+            if (seen.contains(key)) continue;
+            const PurchaseItem* b = baseByKey.value(key);
+            if (b && *b == e) continue;
+            merged << e;
+            r.conflicts << QString("%1: %2 (removed on disk)").arg(label).arg(e.presetId);
+        }
+
+        if (merged != editedItems) r.changedTabs.insert(label);
+        if (!merged.isEmpty()) out.insert(label, merged);
+    }
+    return out;
+}
+
+bool SidebarEngine::readItems(const QString& path, QVector<PurchaseItem>& out, QString* error) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString("cannot open %1").arg(path);
+        return false;
+    }
+    QJsonDocument doc;
+    QString err;
+    if (!parseJsonLenient(f.readAll(), doc, &err)) {
+        if (error) *error = QString("%1: %2").arg(path, err);
+        return false;
+    }
+
+    for (const QJsonValue& v : doc.object().value("GlobalSettings").toArray()) {
+        const QJsonObject ps = v.toObject()["FACTORY_WRAPPER"].toObject()["DATA"].toObject()
+            ["PURCHASE_SETTINGS_DEF_CLASS"].toObject();
+        const int team = ps["TEAM"].toInt();
+        const int type = ps["TYPE"].toInt();
+        for (const QJsonValue& iv : ps["PURCHASE_ITEMS"].toArray()) {
+            const PurchaseItem it = itemFromJson(iv.toObject(), team, type);
+            if (it.presetId != 0) out.append(it);
+        }
+    }
+    return true;
+}
+
+QString SidebarEngine::unitKey(const PurchaseItem& item) {
+    return canonicalPresetKey(item);
+}
+
+int SidebarEngine::applyEdits(TabLists& tabs, const QVector<PurchaseItem>& edits) {
+    QHash<QString, const PurchaseItem*> byKey;
+    for (const PurchaseItem& e : edits) byKey.insert(canonicalPresetKey(e), &e);
+
+    int replaced = 0;
+    for (auto& list : tabs) {
+        for (PurchaseItem& it : list) {
+            const PurchaseItem* src = byKey.value(canonicalPresetKey(it));
+            if (!src) continue;
+
+            // Overwrite everything that belongs to the item (retain team/type by list)
+            it.cost = src->cost;
+            it.texture = src->texture;
+            it.techLevel = src->techLevel;
+            it.specialTechNumber = src->specialTechNumber;
+            it.unitLimit = src->unitLimit;
+            it.factory = src->factory;
+            it.techBuilding = src->techBuilding;
+            it.factoryNotRequired = src->factoryNotRequired;
+
+            it.altPresetIds = src->altPresetIds;
+            it.altTextures = src->altTextures;
+            ++replaced;
+        }
+    }
+    return replaced;
+}
+
+SidebarEngine::MasterReport SidebarEngine::updateMaster(const TabLists& tabs,
+    const QSet<QString>& selectedListIds, bool selectedOnly, JobControl* control) const
+{
+    MasterReport report;
+    const auto edits = editsByKey(tabs);
+    PatchOptions opt;
+    const QString path = masterPath();
+
+    // Progress is counted in list items looked at
+    JobControl local;
+    JobControl& job = control ? *control : local;
+    int total = 0;
+    for (const PurchaseList& pl : m_lists)
+        if (!selectedOnly || selectedListIds.contains(pl.id)) total += pl.items.size();
+    job.setTotal(total);
+
+    JsonCst doc;
+    if (!loadGlobalSettingsDoc(path, doc)) {
+        report.error = QString("Cannot load %1").arg(path);
+        return report;
+    }
+
+    // Where the file still holds what was loaded. The tabs carry every unit,
+    // edited or not, so a unit changed on disk since is merged field by field
+    // against its loaded value rather than written over.
+    struct SectionState {
+        bool clean = false;                    // section text as loaded
+        const SectionSource* loaded = nullptr;
+        QString key;
+    };
+    QHash<JsonCst::Node, SectionState> stateBySection;   // by PURCHASE_SETTINGS_DEF_CLASS node
+    for (const auto& keyed : keyedSections(doc)) {
+        if (job.isCancelled()) break;
+        const JsonCst::Node ps = doc.path(keyed.first, { "FACTORY_WRAPPER", "DATA", "PURCHASE_SETTINGS_DEF_CLASS" });
+        if (ps < 0) continue;
+        SectionState st;
+        st.key = keyed.second;
+        const auto src = m_sources.constFind(keyed.second);
+        if (src != m_sources.constEnd()) {
+            st.loaded = &src.value();
+            st.clean = src->hash == sourceHash(doc.text(keyed.first));
+        }
+        stateBySection.insert(ps, st);
+    }
+    // Keyed like the sections, so a repeated section ("#2") finds its own
+    QHash<QString, const PurchaseItem*> loadedItems;   // "section key/PRESET_ID" -> as loaded
+    for (auto src = m_sources.cbegin(); src != m_sources.cend(); ++src) {
+        if (src->list < 0) continue;
+        for (const PurchaseItem& it : m_lists.at(src->list).items) {
+            const QString key = src.key() + '/' + QString::number(it.presetId);
+            if (!loadedItems.contains(key)) loadedItems.insert(key, &it);
+        }
+    }
+
+    auto patchChecked = [&](JsonCst::Node section, JsonCst::Node item, const PurchaseItem& ours) {
+        const SectionState st = stateBySection.value(section);
+        const int presetId = doc.toInt(doc.member(item, "PRESET_ID"));
+        const bool asLoaded = st.clean
+            || (st.loaded && st.loaded->items.value(presetId) == sourceHash(doc.text(item)));
+        if (asLoaded) return patchItemNode(doc, item, ours, opt);
+
+        const QString where = QString("%1, PRESET_ID %2").arg(st.key).arg(presetId);
+        const PurchaseItem* base = loadedItems.value(st.key + '/' + QString::number(presetId));
+        PurchaseItem merged = coreFieldsOf(doc, item);
+        if (!base) {
+            // Not there at load: nothing to merge against, the disk's stays
+            if (!sameCoreFields(merged, ours)) report.conflicts << where + ": added on disk since loading";
+            return false;
+        }
+        const QStringList clash = mergeCoreFields(merged, *base, ours);
+        if (!clash.isEmpty()) report.conflicts << where + ": " + clash.join(", ");
+        ++report.merged;
+        PatchOptions core = opt;   // the merge covers the core fields only
+        core.textures = core.altArrays = false;
+        return patchItemNode(doc, item, merged, core);
+        };
+
+    if (selectedOnly) {
+        const SectionIndex sections = indexPurchaseSections(doc);
+
+        // Only lists the user selected (id = TEAM/TYPE/NAME)
+        for (const PurchaseList& pl : m_lists) {
+            if (!selectedListIds.contains(pl.id)) continue;
+
+            for (const PurchaseItem& it : pl.items) {
+                if (job.isCancelled()) break;
+                job.advance();
+                auto e = edits.constFind(canonicalPresetKey(it));
+                if (e == edits.constEnd()) continue;
+
+                // The first section of the TEAM/TYPE that holds it
+                for (JsonCst::Node ps : sections.value(TeamType{ pl.team, pl.type })) {
+                    const JsonCst::Node item = findItemNode(doc, ps, it.presetId);
+                    if (item < 0) continue;
+                    report.units.insert(e.key());
+                    if (patchChecked(ps, item, *e)) {
+                        ++report.patched;
+                        job.addChanged();
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    else {
+        const PresetIndex presets = indexPresets(doc);
+        QSet<JsonCst::Node> visited;
+
+        for (const PurchaseList& pl : m_lists) {
+            const TeamType tt{ pl.team, pl.type };
+            for (const PurchaseItem& it : pl.items) {
+                if (job.isCancelled()) break;
+                job.advance();
+                auto e = edits.constFind(canonicalPresetKey(it));
+                if (e == edits.constEnd()) continue;
+
+                // Every occurrence under this TEAM/TYPE, whatever the section NAME: hits all camos
+                for (int at : presets.byPresetId.value(it.presetId)) {
+                    const PresetOccurrence& occ = presets.items.at(at);
+                    if (!(occ.teamType == tt) || visited.contains(occ.item)) continue;
+                    visited.insert(occ.item);
+                    report.units.insert(e.key());
+                    if (patchChecked(occ.section, occ.item, *e)) {
+                        ++report.patched;
+                        job.addChanged();
+                    }
+                }
+            }
+        }
+    }
+
+    // Nothing is written once cancelled, however far the patching got
+    if (job.isCancelled()) {
+        report.cancelled = true;
+        return report;
+    }
+    if (!report.patched || !backUp({ path }, "Update master", &report.error)) return report;
+    if (FileCommit::write(path, doc.serialize()) == FileCommit::Failed)
+        report.error = QString("Cannot write %1").arg(path);
+    return report;
+}
+
+// Push the edited units into every level file that carries them. The
+// cross-level index says which levels hold which PRESET_IDs, so only those
+// files are opened; each is patched like the master (all camos of the
+// TEAM/TYPE) on its own worker.
+SidebarEngine::PropagateReport SidebarEngine::propagateToLevels(const TabLists& tabs, JobControl* control) const {
+    PropagateReport report;
+    JobControl local;
+    JobControl& task = control ? *control : local;
+    const auto edits = editsByKey(tabs);
+    PatchOptions opt;
+
+    LevelPresetIndex index(kLevelIndexCache);
+    index.refresh(m_root);
+
+    struct UnitEdit {
+        TeamType teamType;
+        int presetId;
+        const PurchaseItem* src;
+    };
+    QMap<QString, QVector<UnitEdit>> byLevel;
+    for (const PurchaseList& pl : m_lists) {
+        for (const PurchaseItem& it : pl.items) {
+            auto e = edits.constFind(canonicalPresetKey(it));
+            if (e == edits.constEnd()) continue;
+            for (const QString& level : index.levelsContaining(it.presetId, pl.team, pl.type))
+                byLevel[level].push_back(UnitEdit{ TeamType{ pl.team, pl.type }, it.presetId, &e.value() });
+        }
+    }
+    report.candidates = byLevel.size();
+    if (!report.candidates) return report;
+
+    struct Job {
+        QString level;
+        QVector<UnitEdit> units;
+        int patched = 0;
+        bool failed = false;
+    };
+    QVector<Job> jobs;
+    for (auto it = byLevel.cbegin(); it != byLevel.cend(); ++it)
+        jobs.push_back(Job{ it.key(), it.value() });
+    task.setTotal(jobs.size());
+
+    const QString root = m_root;
+    QStringList paths;
+    for (const Job& job : jobs) paths << LevelPresetIndex::levelFilePath(root, job.level);
+    if (!backUp(paths, "Propagate changes to levels", &report.error)) {
+        for (const Job& job : jobs) report.failed << job.level;
+        return report;
+    }
+
+    auto patchLevel = [&](Job& job) {
+        const QString path = LevelPresetIndex::levelFilePath(root, job.level);
+        JsonCst doc;
+        if (!loadGlobalSettingsDoc(path, doc)) { job.failed = true; return; }
+
+        const SectionIndex sections = indexPurchaseSections(doc);
+        for (const UnitEdit& u : job.units)
+            job.patched += patchPurchaseItem(doc, sections.value(u.teamType), u.presetId, *u.src, opt,
+                /*everyOccurrence*/ true);
+        if (!doc.isModified()) return;
+
+        if (FileCommit::write(path, doc.serialize()) == FileCommit::Failed) job.failed = true;
+        };
+    // Each level is written on its own, so a cancel keeps the ones done
+    QtConcurrent::blockingMap(jobs, [&](Job& job) {
+        if (task.isCancelled()) return;
+        patchLevel(job);
+        if (job.patched) task.addChanged();
+        task.advance();
+        });
+
+    for (const Job& job : jobs) {
+        if (job.failed) report.failed << job.level;
+        if (job.patched) { report.patched += job.patched; ++report.levels; }
+    }
+    report.cancelled = task.isCancelled();
+    return report;
+}
+
+namespace {
+
+// Level update pipeline sizing. Readers spend their time waiting on the
+// share, so there are more of them than cores would suggest; the window
+// caps how many levels sit in memory between being read and being staged.
+const int kLevelReaders = 4;
+const int kLevelWindow = 16;
+
+} // namespace
+
+// Visible items grouped by (TEAM,TYPE); the same for every level.
+using SectionItems = QMap<QPair<int, int>, QVector<const PurchaseItem*>>;
+
+static QString customSectionName(const TeamType& tt) {
+    return QStringLiteral("Sidebar Editor Custom %1 %2 List").arg(teamWord(tt.team), typeWord(tt.type));
+}
+
+// One level of a level update, carried through the pipeline. Each stage
+// frees what the next one no longer needs.
+struct LevelJob {
+    QString level;
+    QString path;
+    QHash<TeamType, int> parentByTT;
+    QVector<int> reservedIds;       // DEF_IDs for sections it may create
+    bool exists = false;
+    QByteArray raw;                 // file as read, kept until staged
+    QVector<TeamType> created;      // sections created, one reserved ID each
+    QByteArray definitions;         // serialized results
+    QByteArray presets;
+    int patched = 0, appended = 0;
+    bool failed = false;
+};
+
+static QByteArray readFileOrEmpty(const QString& path) {
+    QFile f(path);
+    return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+}
+
+// Reader stage: I/O only.
+static void readLevelJob(LevelJob& job) {
+    job.exists = QFile::exists(job.path);
+    if (!job.exists) return;
+    QFile f(job.path);
+    if (!f.open(QIODevice::ReadOnly)) { job.failed = true; return; }
+    job.raw = f.readAll();
+}
+
+// Patch stage: parse, create missing sections, patch/append items and
+// serialize both files. CPU only.
+static void patchLevelJob(LevelJob& job, const SectionItems& perSection) {
+    if (job.failed) return;
+
+    JsonCst doc;
+    if (job.exists) {
+        QString err;
+        if (!doc.parse(job.raw, &err)) {
+            qWarning() << "Cannot parse" << job.path << err;
+            job.failed = true;
+            return;
+        }
+    }
+    else {
+        // new file shell
+        doc.parse("{\n\t\"SCHEMA_VERSION\": 1,\n\t\"GlobalSettings\": [\n\t]\n}\n");
+    }
+    SectionIndex sections = indexPurchaseSections(doc);
+    PatchOptions opt; // coreFields=true, textures=false, altArrays=false
+
+    // Create the missing sections
+    for (auto sec = perSection.cbegin(); sec != perSection.cend(); ++sec) {
+        const TeamType tt{ sec.key().first, sec.key().second };
+        if (!sections.value(tt).isEmpty()) continue;
+        const int defId = job.reservedIds.at(job.created.size());
+        const JsonCst::Node ps = appendSectionBlock(doc, defId, customSectionName(tt), tt.team, tt.type);
+        if (ps < 0) { job.failed = true; return; }
+        sections[tt].push_back(ps);
+        job.created.push_back(tt);
+    }
+
+    // Patch/append items
+    for (auto sec = perSection.cbegin(); sec != perSection.cend(); ++sec) {
+        const QVector<JsonCst::Node>& found = sections[TeamType{ sec.key().first, sec.key().second }];
+        for (const PurchaseItem* ppi : sec.value()) {
+            const PurchaseItem& pi = *ppi;
+            bool existed = false;
+            if (patchPurchaseItem(doc, found, pi.presetId, pi, opt, false, &existed)) {
+                ++job.patched;
+                continue;
+            }
+            if (!existed) {
+                if (appendItemToSection(doc, found.first(), pi)) {
+                    ++job.appended;
+                }
+            }
+        }
+    }
+
+    // The Definitions file, plus the Presets/GlobalSettings.json
+    // (schema/version at top) built from the sections already in memory
+    job.definitions = doc.serialize();
+    job.presets = buildLevelPresetsGlobalSettings(collectLevelDefs(doc), job.parentByTT);
+}
+
+SidebarEngine::LevelReport SidebarEngine::updateLevels(const TabLists& tabs,
+    const QSet<QString>& selectedListIds, const QStringList& levels,
+    const QMap<QString, QString>& camoByLevel, QVector<LevelPlan>* plan, JobControl* control) const
+{
+    LevelReport report;
+    if (plan) plan->resize(levels.size());
+    JobControl local;
+    JobControl& task = control ? *control : local;
+    task.setTotal(levels.size());
+
+    // Build per-run allocator (scan disk once so we never collide)
+    DefIdAllocator idAlloc(collectAllExistingDefIds(m_root));
+
+    const auto rawParentMap = buildParentRefMapFromMaster(
+        masterPath(),
+        [](const QString& nm) { return !nm.contains("(Neutral)", Qt::CaseInsensitive); }
+    );
+    const QHash<TeamType, int> parentByTT_Fallback = flattenParentMap(rawParentMap);
+
+    auto parentByTTForTheme = [&](const QString& theme) -> QHash<TeamType, int> {
+        QHash<TeamType, int> out;
+
+        // 1) seed with first-seen choice for each (TEAM,TYPE) based on selected lists
+        for (const QString& listId : selectedListIds) {
+            int team = 0, type = 0; QString srcName;
+            if (!parseListId(listId, team, type, &srcName)) continue;
+            TeamType key{ team, type };
+            if (!out.contains(key)) {
+                out.insert(key, m_parentIdByListId.value(listId, 0));
+            }
+        }
+        // 2) if we have a themed list in the selection, prefer that as the parent
+        for (const QString& listId : selectedListIds) {
+            int team = 0, type = 0; QString srcName;
+            if (!parseListId(listId, team, type, &srcName)) continue;
+            if (!m_nameByListId.contains(listId)) continue;
+            const QString defName = m_nameByListId.value(listId).toLower();
+            if (!theme.isEmpty() && defName.contains(theme)) {
+                out[TeamType{ team, type }] = m_parentIdByListId.value(listId, 0);
+            }
+        }
+        // 3) still missing anything? fall back to master map
+        for (auto it = parentByTT_Fallback.cbegin(); it != parentByTT_Fallback.cend(); ++it) {
+            if (!out.contains(it.key())) out.insert(it.key(), it.value());
+        }
+        return out;
+        };
+
+    // Levels sharing a theme share the parent choice
+    ThemePlanCache plans(tabs, parentByTTForTheme);
+
+    SectionItems perSection;
+    for (auto it = tabs.cbegin(); it != tabs.cend(); ++it)
+        for (const PurchaseItem& pi : it.value())
+            perSection[{pi.team, pi.type}].append(&pi);
+
+    // Every level gets a block of DEF_IDs up front, one per section it
+    // could lack, handed out in level order. A run then gives the same IDs
+    // however the stages were scheduled; unused ones are simply never written.
+    QVector<LevelJob> jobs;
+    jobs.reserve(levels.size());
+    for (const QString& level : levels) {
+        LevelJob job;
+        job.level = level;
+        job.path = levelFilePath(level);
+        job.parentByTT = plans.parentByTT(camoByLevel.value(level));
+        for (int i = 0; i < perSection.size(); ++i) job.reservedIds.push_back(idAlloc.take());
+        jobs.push_back(job);
+    }
+
+    // read -> patch -> stage, overlapping the share's latency with the
+    // patching. A level holds a window slot from its read until it is
+    // staged, so at most kLevelWindow levels are in memory at once. Readers
+    // and the writer wait on the share and on each other, so they get
+    // threads of their own. Patching is CPU work and runs on the
+    // scheduler's workers, the calling thread being one of them, so the run
+    // never adds patching threads of its own and cannot stall even when it
+    // is itself running on the last free worker.
+    const int patchers = std::max(1, TaskScheduler::instance().workerCount());
+    QThreadPool pool;
+    pool.setMaxThreadCount(kLevelReaders + 1);
+    QSemaphore window(kLevelWindow);
+    BoundedQueue<int> loaded(kLevelWindow), patched(kLevelWindow);
+    std::atomic<int> nextRead{ 0 };
+    std::atomic<int> reading{ kLevelReaders };   // the last reader closes `loaded`
+    LevelJob* const job = jobs.data();   // the stages share jobs without detaching
+    FileTransaction tx(levelUpdateJournal(m_root));
+
+    QVector<QFuture<void>> readers, workers;
+    for (int r = 0; r < kLevelReaders; ++r) {
+        readers << QtConcurrent::run(&pool, [&] {
+            for (int i = nextRead++; i < levels.size() && !task.isCancelled(); i = nextRead++) {
+                window.acquire();
+                readLevelJob(job[i]);
+                loaded.push(i);
+            }
+            if (--reading == 0) loaded.close();
+            });
+    }
+    auto patch = [&] {
+        int i = 0;
+        while (loaded.pop(i)) {
+            patchLevelJob(job[i], perSection);
+            patched.push(i);
+        }
+        };
+    for (int p = 1; p < patchers; ++p) workers << QtConcurrent::run(TaskScheduler::instance().pool(), patch);
+    // The writer stages each file next to its target; nothing is swapped
+    // in until every level made it through. A dry run keeps the before and
+    // after of each file that would change instead.
+    QFuture<void> writer = QtConcurrent::run(&pool, [&] {
+        bool doomed = false;   // a failed level: the batch will be dropped
+        int i = 0;
+        while (patched.pop(i)) {
+            LevelJob& done = job[i];
+            doomed = doomed || done.failed;
+            const QString presetsPath = levelPresetsPath(m_root, done.level);
+            if (plan && !done.failed) {
+                QVector<FileChange>& changes = (*plan)[i].changes;
+                if (done.definitions != done.raw)
+                    changes.push_back({ done.path, done.raw, done.definitions });
+                const QByteArray presetsBefore = readFileOrEmpty(presetsPath);
+                if (done.presets != presetsBefore)
+                    changes.push_back({ presetsPath, presetsBefore, done.presets });
+            }
+            else if (!plan && !doomed) {
+                tx.stage(done.path, done.definitions);
+                tx.stage(presetsPath, done.presets);
+            }
+            done.raw = QByteArray();
+            done.definitions = QByteArray();
+            done.presets = QByteArray();
+            window.release();
+            task.advance();
+        }
+        });
+
+    patch();
+    for (QFuture<void>& f : workers) f.waitForFinished();
+    patched.close();
+    writer.waitForFinished();
+    for (QFuture<void>& f : readers) f.waitForFinished();
+
+    // Nothing is committed once cancelled, however far the levels got
+    if (task.isCancelled()) {
+        tx.rollback();
+        report.cancelled = true;
+        return report;
+    }
+
+    // All or nothing: one bad level leaves every file as it was
+    for (int li = 0; li < jobs.size(); ++li) {
+        const LevelJob& job = jobs.at(li);
+        if (plan) {
+            LevelPlan& p = (*plan)[li];
+            p.level = job.level;
+            p.failed = job.failed;
+            p.patched = job.patched;
+            p.appended = job.appended;
+        }
+        if (job.failed) {
+            report.failed << job.level;
+            continue;
+        }
+        for (int i = 0; i < job.created.size(); ++i) {
+            const TeamType& tt = job.created.at(i);
+            report.created.push_back({ job.level, tt.team, tt.type, job.reservedIds.at(i), customSectionName(tt) });
+            if (plan) (*plan)[li].created.push_back(report.created.last());
+        }
+        const int createdSections = job.created.size();
+        report.updated << QString("%1 (patched %2, appended %3%4)")
+            .arg(job.level).arg(job.patched).arg(job.appended)
+            .arg(createdSections ? QString(", new sections %1").arg(createdSections) : QString());
+    }
+    if (plan) return report;   // dry run: nothing was staged
+    if (!report.failed.isEmpty() || !backUp(tx.targets(), "Update levels", &report.error)) {
+        tx.rollback();
+        report.updated.clear();
+        report.created.clear();
+        return report;
+    }
+    report.committed = tx.commit(&report.error);
+    if (!report.committed) {
+        report.updated.clear();
+        report.created.clear();
+    }
+    return report;
+}
+
+SidebarEngine::ApplyReport SidebarEngine::applyChanges(const QVector<FileChange>& changes,
+    const QString& label) const
+{
+    ApplyReport report;
+    for (const FileChange& c : changes) {
+        const bool asPlanned = c.before.isEmpty()
+            ? QFileInfo(c.path).size() == 0
+            : FileCommit::matchesDisk(c.path, c.before);
+        if (!asPlanned) report.stale << c.path;
+    }
+    if (!report.stale.isEmpty()) return report;
+
+    FileTransaction tx(levelUpdateJournal(m_root));
+    for (const FileChange& c : changes) tx.stage(c.path, c.after);
+    if (!backUp(tx.targets(), label, &report.error)) {
+        tx.rollback();
+        return report;
+    }
+    report.committed = tx.commit(&report.error);
+    return report;
+}
+
+SidebarEngine::ExportReport SidebarEngine::exportAllMapJsons(const TabLists& tabs,
+    const QMap<QString, QString>& camoByLevel, JobControl* control) const
+{
+    ExportReport report;
+    JobControl local;
+    JobControl& task = control ? *control : local;
+    task.setTotal(camoByLevel.size());
+    QStringList paths;
+    for (auto it = camoByLevel.cbegin(); it != camoByLevel.cend(); ++it) paths << levelFilePath(it.key());
+    if (!backUp(paths, "Export all", &report.error)) {
+        report.failed = camoByLevel.keys();
+        return report;
+    }
+    ThemePlanCache plans(tabs);
+
+    for (auto it = camoByLevel.cbegin(); it != camoByLevel.cend(); ++it) {
+        if (task.isCancelled()) {
+            report.cancelled = true;
+            break;
+        }
+        const QString& mapName = it.key();
+        if (FileCommit::write(levelFilePath(mapName), plans.exportJson(it.value())) != FileCommit::Failed)
+            report.exported.append(mapName);
+        else
+            report.failed.append(mapName);
+        task.advance();
+    }
+    return report;
+}
+
+// Reorder camo textures in an existing level's Definitions/GlobalSettings.json
+// using the theme assigned to that level. Returns true if the file was changed.
+SidebarEngine::CamoResult SidebarEngine::reorderCamoInLevelFile(const QString& level, const QString& theme,
+    FileChange* plan) const
+{
+    const QString path = levelFilePath(level);
+    const char desired = themeToCode(theme).toLatin1();
+    if (!desired) return CamoUnchanged;
+
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "reorderCamoInLevelFile: open failed" << path;
+        return CamoFailed;
+    }
+    const QByteArray raw = f.readAll();
+    f.close();
+
+    // No texture of this camo anywhere: nothing can move, skip the parse
+    if (!mentionsCamo(raw, desired)) return CamoUnchanged;
+
+    JsonCst doc;
+    QString err;
+    if (!doc.parse(raw, &err)) {
+        qWarning() << "reorderCamoInLevelFile: cannot parse" << path << err;
+        return CamoFailed;
+    }
+
+    for (JsonCst::Node ps : purchaseSections(doc)) {
+        const JsonCst::Node items = doc.member(ps, "PURCHASE_ITEMS");
+        for (JsonCst::Node item = doc.firstChild(items); item >= 0; item = doc.nextSibling(item)) {
+            if (doc.kind(item) != JsonCst::Object) continue;
+
+            const JsonCst::Node idNode = doc.member(item, "PRESET_ID");
+            const JsonCst::Node texNode = doc.member(item, "TEXTURE");
+            const JsonCst::Node altIdsNode = doc.member(item, "ALT_PRESETIDS");
+            const JsonCst::Node altTexNode = doc.member(item, "ALT_TEXTURES");
+
+            // Which of base + 3 alts carry the camo, from the literals alone.
+            // If none do, or they already lead, the stable sort below would
+            // keep every slot where it is: skip the item without decoding it.
+            bool tagged[4] = {};
+            tagged[0] = texNode >= 0 && camoCodeOfLiteral(doc.text(texNode)) == desired;
+            for (int k = 0; k < 3; ++k) {
+                const JsonCst::Node txK = doc.child(altTexNode, k);
+                tagged[k + 1] = txK >= 0 && camoCodeOfLiteral(doc.text(txK)) == desired;
+            }
+            bool needsMove = false, seenUntagged = false;
+            for (bool t : tagged) {
+                if (!t) seenUntagged = true;
+                else if (seenUntagged) needsMove = true;
+            }
+            if (!needsMove) continue;
+
+            const int baseId = idNode >= 0 ? doc.toInt(idNode) : 0;
+            const QString baseTex = texNode >= 0 ? doc.toString(texNode).trimmed() : QString();
+
+            // Normalize old arrays to length 3
+            QVector<int> oldAltIds(3, 0);
+            QVector<QString> oldAltTex(3, "");
+            for (int k = 0; k < 3; ++k) {
+                const JsonCst::Node idK = doc.child(altIdsNode, k);
+                const JsonCst::Node txK = doc.child(altTexNode, k);
+                if (idK >= 0) oldAltIds[k] = doc.toInt(idK);
+                if (txK >= 0) oldAltTex[k] = doc.toString(txK).trimmed();
+            }
+
+            struct Pair { int id; QString tex; bool tagged; bool hasTex; };
+            QVector<Pair> pairs;
+            pairs.reserve(4);
+
+            auto addPair = [&](int id, const QString& tex, bool isTagged) {
+                const QString t = tex.trimmed();
+                pairs.push_back(Pair{ id, t, isTagged, !t.isEmpty() });
+                };
+
+            addPair(baseId, baseTex, tagged[0]);
+            for (int k = 0; k < 3; ++k)
+                addPair(oldAltIds.at(k), oldAltTex.at(k), tagged[k + 1]);
+
+            // See if at least one entry has a camo tag; otherwise skip
+            const bool anyTagged = std::any_of(pairs.cbegin(), pairs.cend(),
+                [](const Pair& p) { return p.tagged; });
+
+            if (anyTagged) {
+                // Stable priority: desired camo first; keep original relative order otherwise
+                QVector<int> idx(pairs.size());
+                std::iota(idx.begin(), idx.end(), 0);
+                std::stable_sort(idx.begin(), idx.end(),
+                    [&](int a, int b) {
+                        if (pairs[a].tagged != pairs[b].tagged) return pairs[a].tagged; // true first
+                        return a < b;
+                    });
+
+                // Rebuild base + 3 alts from ordered pairs
+                int newBaseId = baseId;
+                QString newBaseTex = baseTex;
+                QVector<int> newAltIds; newAltIds.reserve(3);
+                QVector<QString> newAltTex; newAltTex.reserve(3);
+
+                if (!idx.isEmpty()) {
+                    newBaseId = pairs[idx[0]].id;
+                    newBaseTex = pairs[idx[0]].tex;
+                }
+                for (int n = 1; n <= 3; ++n) {
+                    if (n < idx.size()) {
+                        newAltIds << pairs[idx[n]].id;
+                        newAltTex << pairs[idx[n]].tex;
+                    }
+                    else {
+                        newAltIds << 0;
+                        newAltTex << "";
+                    }
+                }
+
+                // Only write what actually changed
+                if (newBaseTex != baseTex && texNode >= 0)
+                    doc.replace(texNode, jsonQuote(newBaseTex));
+                if (newBaseId != baseId && idNode >= 0)
+                    doc.replace(idNode, QByteArray::number(newBaseId));
+                if (oldAltIds != newAltIds)
+                    patchAltPresetIds(doc, altIdsNode, newAltIds);
+                if (oldAltTex != newAltTex)
+                    patchAltTextures(doc, altTexNode, newAltTex);
+            }
+        }
+    }
+
+    if (!doc.isModified()) return CamoUnchanged;
+
+    if (plan) {
+        plan->path = path;
+        plan->before = raw;
+        plan->after = doc.serialize();
+        return plan->after != raw ? CamoChanged : CamoUnchanged;
+    }
+
+    const FileCommit::Result r = FileCommit::write(path, doc.serialize(), &err);
+    if (r == FileCommit::Failed) {
+        qWarning() << "reorderCamoInLevelFile: write failed" << path << err;
+        return CamoFailed;
+    }
+    return r == FileCommit::Written ? CamoChanged : CamoUnchanged;
+}
+
+
+// Build a section block (empty PURCHASE_ITEMS) with consistent indentation
+static QByteArray buildSectionBlockText(int defId, const QString& name, int team, int type,
+    const QByteArray& i0) {
+    const QByteArray i1 = i0 + "\t";
+    const QByteArray i2 = i1 + "\t";
+    const QByteArray i3 = i2 + "\t";
+
+    return
+        i0 + "{\n" +
+        i1 + "\"FACTORY_ID\": 263687,\n" +
+        i1 + "\"FACTORY_WRAPPER\": {\n" +
+        i2 + "\"DATA\": {\n" +
+        i3 + "\"DEFINITION_BASE\": {\n" +
+        i3 + "\t\"ID\": " + QByteArray::number(defId) + ",\n" +
+        i3 + "\t\"NAME\": " + jsonQuote(name.isEmpty() ? QString::number(defId) : name) + "\n" +
+        i3 + "},\n" +
+        i3 + "\"PURCHASE_SETTINGS_DEF_CLASS\": {\n" +
+        i3 + "\t\"TEAM\": " + QByteArray::number(team) + ",\n" +
+        i3 + "\t\"TYPE\": " + QByteArray::number(type) + ",\n" +
+        i3 + "\t\"PURCHASE_ITEMS\": []\n" +
+        i3 + "}\n" +
+        i2 + "}\n" +
+        i1 + "}\n" +
+        i0 + "}";
+}
+
+
+
+// Append a purchase item object to the section's PURCHASE_ITEMS array,
+// indented like its siblings (or one level in if the array is empty).
+static bool appendItemToSection(JsonCst& doc, JsonCst::Node section, const PurchaseItem& it)
+{
+    const JsonCst::Node items = doc.member(section, "PURCHASE_ITEMS");
+    if (items < 0 || doc.kind(items) != JsonCst::Array) return false;
+    const QByteArray elemIndent = doc.elementIndent(items);
+
+    // Helpers to render the ALT_* arrays with closing ']' aligned to the key line
+    auto arr3i = [&](const QVector<int>& xs) {
+        const QByteArray valIndent = elemIndent + "\t\t";
+        const QByteArray closeIndent = elemIndent + "\t";
+        return "[\n" + valIndent + QByteArray::number(xs.value(0, 0)) + ",\n" +
+            valIndent + QByteArray::number(xs.value(1, 0)) + ",\n" +
+            valIndent + QByteArray::number(xs.value(2, 0)) + "\n" +
+            closeIndent + "]";
+        };
+    auto arr3s = [&](const QVector<QString>& xs) {
+        const QByteArray valIndent = elemIndent + "\t\t";
+        const QByteArray closeIndent = elemIndent + "\t";
+        auto q = [](const QString& s) { return jsonQuote(canonEmpty(s)); };
+        return "[\n" + valIndent + q(xs.value(0)) + ",\n" +
+            valIndent + q(xs.value(1)) + ",\n" +
+            valIndent + q(xs.value(2)) + "\n" +
+            closeIndent + "]";
+        };
+
+    // 4) Item JSON (braces and keys at elemIndent)
+    const QByteArray itemText =
+        elemIndent + "{\n" +
+        elemIndent + "\t\"COST\": " + QByteArray::number(it.cost) + ",\n" +
+        elemIndent + "\t\"PRESET_ID\": " + QByteArray::number(it.presetId) + ",\n" +
+        elemIndent + "\t\"STRING_ID\": " + QByteArray::number(it.stringId) + ",\n" +
+        elemIndent + "\t\"TEXTURE\": " + jsonQuote(it.texture) + ",\n" +
+        elemIndent + "\t\"TECH_LEVEL\": " + QByteArray::number(it.techLevel) + ",\n" +
+        elemIndent + "\t\"SPECIAL_TECH_NUMBER\": " + QByteArray::number(it.specialTechNumber) + ",\n" +
+        elemIndent + "\t\"UNIT_LIMIT\": " + QByteArray::number(it.unitLimit) + ",\n" +
+        elemIndent + "\t\"FACTORY\": " + QByteArray::number(it.factory) + ",\n" +
+        elemIndent + "\t\"TECH_BUILDING\": " + QByteArray::number(it.techBuilding) + ",\n" +
+        elemIndent + "\t\"FACTORY_NOT_REQUIRED\": " + (it.factoryNotRequired ? QByteArrayLiteral("true") : QByteArrayLiteral("false")) + ",\n" +
+        elemIndent + "\t\"ALT_PRESETIDS\": " + arr3i(it.altPresetIds) + ",\n" +
+        elemIndent + "\t\"ALT_TEXTURES\": " + arr3s(it.altTextures) + "\n" +
+        elemIndent + "}";
+
+    // 5) Append; the document supplies the separators
+    return doc.appendElement(items, itemText) >= 0;
+}
@@ -0,0 +1,218 @@
+// SidebarEngine.h
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "PurchaseItem.h"
+
+class JobControl;
+class JsonStreamWriter;
+
+// Tab label ("Allied Vehicles") -> the merged items shown in that tab.
+using TabLists = QMap<QString, QVector<PurchaseItem>>;
+
+// The document work behind the editor's menu actions, with no UI: reading
+// the master's purchase lists, patching the master and level GlobalSettings
+// files, camo reordering and exports. MainWindow drives it from dialogs and
+// the --batch command line drives it headless; every operation returns a
+// report and leaves presenting it to the caller.
+class SidebarEngine {
+public:
+    explicit SidebarEngine(const QString& levelEditRoot = QString());
+
+    void setRoot(const QString& levelEditRoot) { m_root = levelEditRoot; }
+    const QString& root() const { return m_root; }
+    QString masterPath() const;
+    QString levelFilePath(const QString& level) const;
+    QStringList levels() const;   // RA_* folders under Database/Levels
+
+    // Every operation that rewrites files first snapshots them into the
+    // BackupStore under the root; new contents are stored compressed unless
+    // this is turned off.
+    void setBackupCompression(bool on) { m_compressBackups = on; }
+    // The snapshot taken before a write; also for callers that drive the
+    // writes themselves (camo reorder). False if the files could not all be
+    // stored, and the write should then not happen.
+    bool backUp(const QStringList& paths, const QString& label, QString* error = nullptr) const;
+
+    // --- model ---
+    // Purchase lists of a master file; Neutral, Equipment and Ignore lists
+    // and items without a texture are skipped. False if it cannot be read.
+    bool loadMaster(const QString& path, QString* error = nullptr);
+    const QVector<PurchaseList>& lists() const { return m_lists; }
+
+    struct ReloadReport {
+        QStringList changed;   // list ids whose section text differs
+        QStringList added;
+        QStringList removed;
+        int decoded = 0;       // sections decoded again
+        QString error;         // empty on success; the model is then untouched
+    };
+    // Reads the master again. Each section's source text is hashed and only
+    // the ones that differ from the last read are decoded.
+    ReloadReport reloadMaster(const QString& path);
+
+    // The selected lists grouped into tabs, units merged by canonical key.
+    TabLists tabsForSelection(const QSet<QString>& selectedListIds) const;
+    static QString tabLabel(int type, int team);
+    // Canonical key of a unit: its base and alt preset IDs, sorted.
+    static QString unitKey(const PurchaseItem& item);
+    // The tabs as a map with this theme would get them (its camo first).
+    static TabLists listsForTheme(TabLists lists, const QString& theme);
+
+    struct MergeReport {
+        QStringList conflicts;     // "Allied Vehicles: 1234", edited here and changed on disk
+        QSet<QString> changedTabs; // tabs whose items differ from the working copy
+        int fromDisk = 0;          // items taken from the reloaded master
+    };
+    // Three-way merge of the tabs after a reload, unit by unit (canonical
+    // key). base: the tabs as loaded before, edited: the working copy,
+    // fresh: the tabs of the reloaded master. Units not edited here follow
+    // the disk; edited ones keep the edit, and are a conflict if the disk
+    // changed them too.
+    static TabLists mergeTabs(const TabLists& base, const TabLists& edited, const TabLists& fresh,
+        MergeReport* report = nullptr);
+
+    // Purchase items of any GlobalSettings-shaped file (master, level, export).
+    static bool readItems(const QString& path, QVector<PurchaseItem>& out, QString* error = nullptr);
+    // Overwrites the tab items that match an edit (base + alt preset IDs).
+    // Returns how many items were replaced.
+    static int applyEdits(TabLists& tabs, const QVector<PurchaseItem>& edits);
+
+    // --- operations ---
+    struct MasterReport {
+        int patched = 0;
+        int merged = 0;          // units changed on disk since loading, merged field by field
+        QStringList conflicts;   // "TEAM=0|TYPE=0|NAME=..., PRESET_ID n: COST", left as on disk
+        QString error;           // empty on success
+        bool cancelled = false;  // stopped through the JobControl; nothing written
+        QSet<QString> units;     // unitKey of each unit found in the file, whether it changed or not
+    };
+    // selectedOnly: patch the sections of the selected lists. Otherwise every
+    // occurrence of an edited unit under its TEAM/TYPE, i.e. all camos.
+    // Sections and units still as loaded (by source hash) are patched as
+    // they are; the others get a three-way merge of the core fields and a
+    // field changed on both sides is kept as on disk and reported.
+    // Safe to run on a worker as long as the model is not reloaded meanwhile;
+    // control, if given, gets progress in list items and can stop it.
+    MasterReport updateMaster(const TabLists& tabs, const QSet<QString>& selectedListIds, bool selectedOnly,
+        JobControl* control = nullptr) const;
+
+    struct LevelReport {
+        struct Created {
+            QString level;
+            int team = 0;
+            int type = 0;
+            int defId = 0;
+            QString name;
+        };
+        QStringList updated;       // "RA_X (patched n, appended m)"
+        QStringList failed;        // levels that could not be patched
+        QVector<Created> created;  // custom sections added, with their DEF_IDs
+        QString error;             // commit failure
+        bool committed = false;    // false: no file was changed
+        bool cancelled = false;    // stopped before the commit
+    };
+    // One file an operation would rewrite, as it is and as it would be.
+    struct FileChange {
+        QString path;
+        QByteArray before;   // empty for a new file
+        QByteArray after;
+    };
+    // What updateLevels would do to one level.
+    struct LevelPlan {
+        QString level;
+        int patched = 0;
+        int appended = 0;
+        QVector<LevelReport::Created> created;   // sections and the DEF_IDs they would get
+        QVector<FileChange> changes;             // only files that would differ
+        bool failed = false;
+    };
+    // Writes the tabs into each level's Definitions file, adding the custom
+    // sections it lacks, and regenerates its Presets file. Levels are patched
+    // on the thread pool and all files are committed together or not at all.
+    // With plan set it is a dry run: nothing is written and *plan gets one
+    // entry per level, in level order. control, if given, gets progress in
+    // levels and can stop the run before anything is committed.
+    LevelReport updateLevels(const TabLists& tabs, const QSet<QString>& selectedListIds,
+        const QStringList& levels, const QMap<QString, QString>& camoByLevel,
+        QVector<LevelPlan>* plan = nullptr, JobControl* control = nullptr) const;
+
+    struct ApplyReport {
+        QStringList stale;      // files no longer as planned; nothing was written
+        QString error;          // backup or commit failure
+        bool committed = false;
+    };
+    // Writes the reviewed changes of a dry run, all or none, after backing
+    // up the files they replace. Every file must still hold its `before`
+    // (an empty one: absent or empty); otherwise nothing is written and the
+    // plan should be made again.
+    ApplyReport applyChanges(const QVector<FileChange>& changes, const QString& label) const;
+
+    struct PropagateReport {
+        int candidates = 0;   // levels holding an edited unit
+        int levels = 0;       // levels actually changed
+        int patched = 0;
+        QStringList failed;
+        QString error;        // the backup failed; nothing was written
+        bool cancelled = false;   // levels not reached were left as they were
+    };
+    // Patches every level file that carries an edited unit, found through
+    // the cached LevelPresetIndex. control, if given, gets progress in
+    // levels and can stop it between levels.
+    PropagateReport propagateToLevels(const TabLists& tabs, JobControl* control = nullptr) const;
+
+    enum CamoResult {
+        CamoUnchanged,   // already in order, or no texture of the camo
+        CamoChanged,
+        CamoFailed,      // could not be read, parsed or written
+    };
+    // Camo reorder of one level's Definitions file. With plan set nothing
+    // is written and *plan gets the would-be change.
+    CamoResult reorderCamoInLevelFile(const QString& level, const QString& theme, FileChange* plan = nullptr) const;
+
+    struct ExportReport {
+        QStringList exported;
+        QStringList failed;
+        QString error;        // the backup failed; nothing was written
+        bool cancelled = false;   // levels not reached were left as they were
+    };
+    // Replaces each assigned level's Definitions file with the tabs for its
+    // camo. control, if given, gets progress in levels and can stop it
+    // between levels.
+    ExportReport exportAllMapJsons(const TabLists& tabs, const QMap<QString, QString>& camoByLevel,
+        JobControl* control = nullptr) const;
+    static void writeExportJson(JsonStreamWriter& w, const TabLists& lists);
+
+    // FileTransaction journal of updateLevels, kept in the LevelEdit folder
+    // so every editor and batch run on it settles the same batch.
+    static QString levelUpdateJournal(const QString& levelEditRoot);
+    static constexpr const char* kLevelIndexCache = "level_preset_index.json";
+
+private:
+    bool readMaster(const QString& path, int* decoded, QString* error);
+
+    QString m_root;
+    bool m_compressBackups = true;
+    QVector<PurchaseList> m_lists;
+    QHash<QString, int> m_parentIdByListId;   // DEFINITION_BASE.ID of each source list
+    QHash<QString, QString> m_nameByListId;   // DEFINITION_BASE.NAME of each source list
+    // Master sections by the hash of their source text, as last read
+    QHash<QByteArray, int> m_listBySectionHash;        // -> index in m_lists
+    QHash<QString, QByteArray> m_sectionHashByListId;
+    QSet<QByteArray> m_skippedSections;                // sections that hold no shown list
+    // Every section's source hash and its items' (by PRESET_ID) as last
+    // read, by section key (list id, "#n" for repeats); checked at save
+    struct SectionSource {
+        QByteArray hash;
+        QHash<int, QByteArray> items;
+        int list = -1;   // its list in m_lists; -1 if it shows none
+    };
+    QHash<QString, SectionSource> m_sources;
+};
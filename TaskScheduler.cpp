@@ -0,0 +1,49 @@
+// TaskScheduler.cpp
+#include "TaskScheduler.h"
+#include "JobControl.h"
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <utility>
+
+namespace {
+
+class Task : public QRunnable {
+public:
+    Task(std::function<void()> fn, std::shared_ptr<const JobControl> control)
+        : m_fn(std::move(fn)), m_control(std::move(control)) {
+        setAutoDelete(true);
+    }
+
+    void run() override {
+        if (m_control && m_control->isCancelled()) return;
+        m_fn();
+    }
+
+private:
+    std::function<void()> m_fn;
+    std::shared_ptr<const JobControl> m_control;
+};
+
+} // namespace
+
+TaskScheduler& TaskScheduler::instance() {
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+void TaskScheduler::setWorkerCount(int workers) {
+    pool()->setMaxThreadCount(workers > 0 ? workers : QThread::idealThreadCount());
+}
+
+int TaskScheduler::workerCount() const {
+    return pool()->maxThreadCount();
+}
+
+QThreadPool* TaskScheduler::pool() const {
+    return QThreadPool::globalInstance();
+}
+
+void TaskScheduler::post(Priority priority, std::function<void()> fn, std::shared_ptr<const JobControl> control) {
+    pool()->start(new Task(std::move(fn), std::move(control)), priority);
+}
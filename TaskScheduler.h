@@ -0,0 +1,41 @@
+// TaskScheduler.h
+#pragma once
+
+#include <functional>
+#include <memory>
+
+class JobControl;
+class QThreadPool;
+
+// The one set of worker threads the editor runs its background work on:
+// icon conversion, master and level updates, scans, exports. It is Qt's
+// global thread pool, so QtConcurrent::run/map calls without an explicit
+// pool share the same workers and the machine is never asked for more
+// threads than workerCount(), whichever subsystems are busy at once.
+//
+// post() queues a task with a priority; queued work is started highest
+// priority first, so an icon the user is looking at does not wait behind a
+// level batch. Running tasks are never preempted.
+class TaskScheduler {
+public:
+    enum Priority {
+        Batch = 0,          // bulk file work; also where plain QtConcurrent calls run
+        Background = 5,     // scans and caches nobody is waiting on
+        Interactive = 10,   // something on screen is waiting for it
+    };
+
+    static TaskScheduler& instance();
+
+    // 0: one worker per core.
+    void setWorkerCount(int workers);
+    int workerCount() const;
+    QThreadPool* pool() const;
+
+    // Runs fn on a worker. With control, a task cancelled before a worker
+    // picks it up is dropped; fn itself checks control for cancellation
+    // while it runs.
+    void post(Priority priority, std::function<void()> fn, std::shared_ptr<const JobControl> control = nullptr);
+
+private:
+    TaskScheduler() = default;
+};
@@ -1,9 +1,18 @@
 // main.cpp
 #include <QApplication>
+#include <QCoreApplication>
+#include "BatchCli.h"
 #include "MainWindow.h"
 
 int main(int argc, char* argv[])
 {
+    // Headless runs never create a QApplication, so no display is needed
+    if (BatchCli::requested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        QCoreApplication::setApplicationName("SidebarEditor");
+        return BatchCli::run(app.arguments());
+    }
+
     QApplication app(argc, argv);
     MainWindow window;
     window.setWindowTitle("Sidebar Editor");